@@ -0,0 +1,325 @@
+/*
+ * bench_isha.c
+ *
+ * Host benchmark runner for the ISHA/PBKDF1 core. Sweeps message sizes,
+ * ISHAInput chunk sizes and PBKDF1 iteration counts and reports the
+ * results as CSV on stdout.
+ *
+ * Each sample is repeated until it has run for at least the minimum
+ * sample time, and the fastest of several samples is reported, so that
+ * runs on the same machine are comparable.
+ *
+ * isha_prefix rows hash a shared prefix plus a SUFFIX_LEN-byte suffix,
+ * once from scratch ("full") and once resumed from an ISHAState saved
+ * after the prefix ("midstate").
+ *
+ * pbkdf1_batch rows derive BATCH_SIZE keys per call and report the
+ * per-derivation figures, so they compare directly with the pbkdf1 rows.
+ *
+ * pbkdf2 rows derive a msg_bytes-long key with HMAC-ISHA; each iteration
+ * of each output block is two compressions. pbkdf2_parallel rows spread
+ * the blocks of the same key over one thread per CPU.
+ *
+ * Usage: isha_bench [-t min_sample_ms] [-s samples]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isha.h"
+#include "pbkdf1.h"
+#include "pbkdf2_parallel.h"
+
+#define MAX_MSG_LEN (64 * 1024)
+#define BATCH_SIZE  64
+#define SUFFIX_LEN  16
+
+static const size_t msg_sizes[] = { 20, 55, 64, 256, 1024, 4096, 16384, MAX_MSG_LEN };
+static const size_t chunk_sizes[] = { 1, 10, 64, 0 };   // 0 = whole message in one call
+static const size_t prefix_sizes[] = { 64, 128, 256, 512, 1024, 2048, 4096 };
+static const uint32_t iteration_counts[] = { 1, 16, 256, 4096, 16384 };
+static const size_t pbkdf2_dk_lens[] = { 20, 100 };
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint64_t min_sample_ns = 50 * 1000 * 1000ULL;
+static int samples = 5;
+
+// Keeps the optimizer from discarding the work being timed
+static volatile uint8_t sink;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Number of times ISHAProcessMessageBlock runs for a message of len
+ * bytes: the message plus the 0x80 marker and 8 length bytes, rounded
+ * up to whole blocks.
+ */
+static uint64_t blocks_for(size_t len) {
+	return (len + 9 + ISHA_BLOCKLEN - 1) / ISHA_BLOCKLEN;
+}
+
+/*
+ * Hashes msg once, feeding it to ISHAInput in chunk-sized pieces.
+ */
+static void hash_once(const uint8_t *msg, size_t len, size_t chunk) {
+	ISHAContext ctx;
+	uint8_t digest[ISHA_DIGESTLEN];
+
+	if (chunk == 0)
+		chunk = len;
+
+	ISHAReset(&ctx);
+	while (len > 0) {
+		size_t n = len < chunk ? len : chunk;
+		ISHAInput(&ctx, msg, n);
+		msg += n;
+		len -= n;
+	}
+	ISHAResult(&ctx, digest);
+	sink ^= digest[0];
+}
+
+/*
+ * Returns the best-of-samples time for one call to hash_once, in ns.
+ */
+static double time_hash(const uint8_t *msg, size_t len, size_t chunk) {
+	double best = 0;
+
+	for (int s = 0; s < samples; s++) {
+		uint64_t reps = 0, start = now_ns(), elapsed;
+		do {
+			hash_once(msg, len, chunk);
+			reps++;
+			elapsed = now_ns() - start;
+		} while (elapsed < min_sample_ns);
+
+		double per_call = (double) elapsed / reps;
+		if (s == 0 || per_call < best)
+			best = per_call;
+	}
+	return best;
+}
+
+/*
+ * Returns the best-of-samples time, in ns, to hash prefix || suffix,
+ * either from scratch or resumed from the midstate after the prefix.
+ */
+static double time_prefix(const uint8_t *msg, size_t prefix, bool midstate) {
+	ISHAContext ctx;
+	ISHAState state;
+	uint8_t digest[ISHA_DIGESTLEN];
+	double best = 0;
+
+	ISHAReset(&ctx);
+	ISHAInput(&ctx, msg, prefix);
+	ISHASaveState(&ctx, &state);
+
+	for (int s = 0; s < samples; s++) {
+		uint64_t reps = 0, start = now_ns(), elapsed;
+		do {
+			if (midstate) {
+				ISHARestoreState(&ctx, &state);
+			} else {
+				ISHAReset(&ctx);
+				ISHAInput(&ctx, msg, prefix);
+			}
+			ISHAInput(&ctx, msg + prefix, SUFFIX_LEN);
+			ISHAResult(&ctx, digest);
+			sink ^= digest[0];
+			reps++;
+			elapsed = now_ns() - start;
+		} while (elapsed < min_sample_ns);
+
+		double per_call = (double) elapsed / reps;
+		if (s == 0 || per_call < best)
+			best = per_call;
+	}
+	return best;
+}
+
+/*
+ * Returns the best-of-samples time for one pbkdf1 derivation, in ns.
+ */
+static double time_pbkdf1(uint32_t iterations) {
+	static const char pass[] = "Boulder";
+	static const char salt[] = "Buffaloes";
+	uint8_t dk[ISHA_DIGESTLEN];
+	double best = 0;
+
+	for (int s = 0; s < samples; s++) {
+		uint64_t reps = 0, start = now_ns(), elapsed;
+		do {
+			pbkdf1((const uint8_t *) pass, sizeof(pass) - 1,
+					(const uint8_t *) salt, sizeof(salt) - 1, iterations, dk,
+					ISHA_DIGESTLEN);
+			sink ^= dk[0];
+			reps++;
+			elapsed = now_ns() - start;
+		} while (elapsed < min_sample_ns);
+
+		double per_call = (double) elapsed / reps;
+		if (s == 0 || per_call < best)
+			best = per_call;
+	}
+	return best;
+}
+
+/*
+ * Returns the best-of-samples time for one pbkdf1_batch call over
+ * BATCH_SIZE derivations, in ns.
+ */
+static double time_pbkdf1_batch(uint32_t iterations) {
+	static char salts[BATCH_SIZE][16];
+	static Pbkdf1Input in[BATCH_SIZE];
+	static uint8_t dk[BATCH_SIZE * ISHA_DIGESTLEN];
+	double best = 0;
+
+	for (int j = 0; j < BATCH_SIZE; j++) {
+		snprintf(salts[j], sizeof(salts[j]), "Buffaloes%02d", j);
+		in[j].p = (const uint8_t *) "Boulder";
+		in[j].pLen = 7;
+		in[j].s = (const uint8_t *) salts[j];
+		in[j].sLen = strlen(salts[j]);
+	}
+
+	for (int s = 0; s < samples; s++) {
+		uint64_t reps = 0, start = now_ns(), elapsed;
+		do {
+			pbkdf1_batch(in, BATCH_SIZE, iterations, dk, ISHA_DIGESTLEN);
+			sink ^= dk[0];
+			reps++;
+			elapsed = now_ns() - start;
+		} while (elapsed < min_sample_ns);
+
+		double per_call = (double) elapsed / reps;
+		if (s == 0 || per_call < best)
+			best = per_call;
+	}
+	return best;
+}
+
+/*
+ * Returns the best-of-samples time for one PBKDF2-HMAC-ISHA derivation
+ * of a dkLen-byte key, in ns. threads = 0 uses pbkdf2 itself.
+ */
+static double time_pbkdf2(uint32_t iterations, size_t dkLen, int threads) {
+	static uint8_t dk[256];
+	double best = 0;
+
+	for (int s = 0; s < samples; s++) {
+		uint64_t reps = 0, start = now_ns(), elapsed;
+		do {
+			if (threads == 0)
+				pbkdf2(&ishaHashAlgo, (const uint8_t *) "Boulder", 7,
+						(const uint8_t *) "Buffaloes", 9, iterations, dk, dkLen);
+			else
+				pbkdf2_parallel(&ishaHashAlgo, (const uint8_t *) "Boulder", 7,
+						(const uint8_t *) "Buffaloes", 9, iterations, dk, dkLen,
+						threads);
+			sink ^= dk[0];
+			reps++;
+			elapsed = now_ns() - start;
+		} while (elapsed < min_sample_ns);
+
+		double per_call = (double) elapsed / reps;
+		if (s == 0 || per_call < best)
+			best = per_call;
+	}
+	return best;
+}
+
+int main(int argc, char **argv) {
+	static uint8_t msg[MAX_MSG_LEN];
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:s:")) != -1) {
+		switch (opt) {
+		case 't':
+			min_sample_ns = strtoull(optarg, NULL, 10) * 1000 * 1000ULL;
+			break;
+		case 's':
+			samples = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t min_sample_ms] [-s samples]\n",
+					argv[0]);
+			return 1;
+		}
+	}
+	if (samples < 1)
+		samples = 1;
+
+	for (size_t i = 0; i < sizeof(msg); i++)
+		msg[i] = (uint8_t) (i * 131 + 7);
+
+	printf("bench,msg_bytes,chunk_bytes,iterations,ns_per_call,ns_per_byte,"
+			"blocks_per_sec,derivations_per_sec\n");
+
+	for (size_t m = 0; m < ARRAY_LEN(msg_sizes); m++) {
+		for (size_t c = 0; c < ARRAY_LEN(chunk_sizes); c++) {
+			size_t len = msg_sizes[m], chunk = chunk_sizes[c];
+			double ns = time_hash(msg, len, chunk);
+
+			printf("isha,%zu,%zu,,%.1f,%.3f,%.0f,\n", len, chunk ? chunk : len,
+					ns, ns / len, blocks_for(len) * 1e9 / ns);
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_LEN(prefix_sizes); i++) {
+		size_t len = prefix_sizes[i] + SUFFIX_LEN;
+		double full = time_prefix(msg, prefix_sizes[i], false);
+		double mid = time_prefix(msg, prefix_sizes[i], true);
+
+		printf("isha_prefix_full,%zu,,,%.1f,%.3f,%.0f,\n", len, full, full / len,
+				blocks_for(len) * 1e9 / full);
+		printf("isha_prefix_midstate,%zu,,,%.1f,%.3f,%.0f,\n", len, mid,
+				mid / len, blocks_for(SUFFIX_LEN) * 1e9 / mid);
+	}
+
+	for (size_t i = 0; i < ARRAY_LEN(iteration_counts); i++) {
+		uint32_t c = iteration_counts[i];
+		double ns = time_pbkdf1(c);
+
+		printf("pbkdf1,16,,%u,%.1f,,%.0f,%.1f\n", c, ns,
+				c * 1e9 / ns, 1e9 / ns);
+	}
+
+	for (size_t i = 0; i < ARRAY_LEN(iteration_counts); i++) {
+		uint32_t c = iteration_counts[i];
+		double ns = time_pbkdf1_batch(c) / BATCH_SIZE;
+
+		printf("pbkdf1_batch,18,,%u,%.1f,,%.0f,%.1f\n", c, ns,
+				c * 1e9 / ns, 1e9 / ns);
+	}
+
+	for (size_t d = 0; d < ARRAY_LEN(pbkdf2_dk_lens); d++) {
+		size_t dkLen = pbkdf2_dk_lens[d];
+		uint64_t blocks = (dkLen + ISHA_DIGESTLEN - 1) / ISHA_DIGESTLEN;
+		int cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+		for (size_t i = 0; i < ARRAY_LEN(iteration_counts); i++) {
+			uint32_t c = iteration_counts[i];
+			double ns = time_pbkdf2(c, dkLen, 0);
+
+			printf("pbkdf2,%zu,,%u,%.1f,,%.0f,%.1f\n", dkLen, c, ns,
+					2 * c * blocks * 1e9 / ns, 1e9 / ns);
+			if (blocks > 1) {
+				ns = time_pbkdf2(c, dkLen, cpus);
+				printf("pbkdf2_parallel,%zu,,%u,%.1f,,%.0f,%.1f\n", dkLen, c, ns,
+						2 * c * blocks * 1e9 / ns, 1e9 / ns);
+			}
+		}
+	}
+
+	return 0;
+}
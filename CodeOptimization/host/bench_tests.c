@@ -0,0 +1,85 @@
+/*
+ * bench_tests.c
+ *
+ * Checks the benchmark registry and console command in bench.c on the
+ * host, where cycles are nanoseconds. Runs every benchmark once, so the
+ * BENCH lines on stdout can also be fed to benchcmp.py. Exits non-zero
+ * if any test fails.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "bench.h"
+#include "ticktime.h"
+
+static const char *const required[] = {
+	"isha_block", "pbkdf1", "cmp_bin", "hexstr_to_bytes"
+};
+
+static const char *const bad_commands[] = {
+	"", "bench", "bench nosuch", "bench cmp_bin x", "bench cmp_bin 20 65",
+	"bench all 65", "bench list 1", "bench cmp_bin 1 2 3", "bnch list"
+};
+
+int main(void) {
+	BenchResult result;
+	const Bench *bench;
+	int test = 0, tests_passed = 0;
+	bool ok = true;
+	size_t i;
+
+	init_ticktime();
+
+	// The requested benchmarks are all registered
+	for (i = 0; i < sizeof(required) / sizeof(required[0]); i++)
+		ok = ok && bench_find(required[i]) != NULL;
+	ok = ok && bench_find("nosuch") == NULL && bench_count() >= 4;
+	printf("bench test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Results are ordered, and defaults apply for arg and reps
+	ok = true;
+	for (i = 0; i < bench_count(); i++) {
+		bench = bench_get(i);
+		ok = ok && bench_run(bench, 0, 0, &result)
+				&& result.bench == bench
+				&& result.arg == bench->default_arg
+				&& result.reps == BENCH_DEFAULT_REPS
+				&& result.min <= result.median && result.median <= result.max;
+	}
+	ok = ok && bench_run(bench_find("cmp_bin"), 64, 1, &result)
+			&& result.arg == 64 && result.reps == 1
+			&& result.min == result.median && result.median == result.max;
+	ok = ok && !bench_run(bench_find("cmp_bin"), 0, BENCH_MAX_REPS + 1, &result);
+	printf("bench test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// More work takes longer
+	ok = bench_run(bench_find("pbkdf1"), 64, 5, &result);
+	uint32_t short_run = result.median;
+	ok = ok && bench_run(bench_find("pbkdf1"), 4096, 5, &result)
+			&& result.median > short_run;
+	printf("bench test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Console commands
+	ok = bench_command("bench list") && bench_command("  bench cmp_bin  ")
+			&& bench_command("bench hexstr_to_bytes 256 3")
+			&& bench_command("bench all 3");
+	for (i = 0; i < sizeof(bad_commands) / sizeof(bad_commands[0]); i++)
+		ok = ok && !bench_command(bad_commands[i]);
+	printf("bench test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	if (test != tests_passed) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+	printf("All tests passed!\r\n");
+	return 0;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+benchcmp.py
+
+Collects the BENCH lines that bench.c prints on the debug console and
+compares two firmware builds. Each log is a capture of the console (or
+any file containing BENCH lines); other lines are ignored, and when a
+benchmark was run more than once with the same argument the last run
+counts.
+
+    BENCH,<build>,<name>,<arg>,<reps>,<cycles/sec>,<min>,<median>,<max>
+
+Usage:
+  benchcmp.py --csv LOG...          all results as CSV, with a header
+  benchcmp.py [--threshold PCT] BASE NEW
+                                    median cycles of NEW against BASE;
+                                    exits 1 if any benchmark is slower
+                                    by more than PCT percent (default 5)
+"""
+
+import argparse
+import csv
+import sys
+
+FIELDS = ["build", "name", "arg", "reps", "hz", "min", "median", "max"]
+
+
+def read_results(path):
+    """Returns {(name, arg): row} for the BENCH lines in path ('-' is stdin)."""
+    results = {}
+    f = sys.stdin if path == "-" else open(path, errors="replace")
+    with f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("BENCH,"):
+                continue
+            parts = line.split(",")[1:]
+            if len(parts) != len(FIELDS):
+                continue
+            row = dict(zip(FIELDS, parts))
+            for key in FIELDS[2:]:
+                row[key] = int(row[key])
+            results[(row["name"], row["arg"])] = row
+    return results
+
+
+def write_csv(paths):
+    out = csv.writer(sys.stdout, lineterminator="\n")
+    out.writerow(FIELDS)
+    for path in paths:
+        for row in read_results(path).values():
+            out.writerow([row[k] for k in FIELDS])
+
+
+def compare(base_path, new_path, threshold):
+    base, new = read_results(base_path), read_results(new_path)
+    regressions = 0
+
+    print("%-20s %10s %12s %12s %8s" % ("benchmark", "arg", "base", "new", "change"))
+    for key in sorted(base.keys() & new.keys()):
+        b, n = base[key], new[key]
+        if b["hz"] != n["hz"]:
+            print("%-20s %10d  cycle rates differ, not compared" % key)
+            continue
+        change = (n["median"] - b["median"]) * 100.0 / max(b["median"], 1)
+        flag = ""
+        if change > threshold:
+            flag = "  SLOWER"
+            regressions += 1
+        print("%-20s %10d %12d %12d %+7.1f%%%s"
+              % (key[0], key[1], b["median"], n["median"], change, flag))
+    for key in sorted(base.keys() ^ new.keys()):
+        print("%-20s %10d  only in %s" % (key[0], key[1],
+              base_path if key in base else new_path))
+    return 1 if regressions else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Collect and compare BENCH results")
+    ap.add_argument("--csv", action="store_true", help="print all results as CSV")
+    ap.add_argument("--threshold", type=float, default=5.0,
+                    help="percent slowdown counted as a regression")
+    ap.add_argument("logs", nargs="+")
+    args = ap.parse_args()
+
+    if args.csv:
+        write_csv(args.logs)
+        return 0
+    if len(args.logs) != 2:
+        ap.error("give BASE and NEW logs to compare")
+    return compare(args.logs[0], args.logs[1], args.threshold)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,437 @@
+/*
+ * bulk_derive.c
+ *
+ * Host bulk key-derivation engine built on pbkdf1()/pbkdf1_batch().
+ *
+ * Reads one record per line from the input file,
+ *
+ *     password<TAB>salt<TAB>iterations
+ *
+ * and writes one derived key per line, as hex, to the output file in
+ * the same order as the input. A record that cannot be parsed or
+ * derived produces an "ERROR <code>" line in its place.
+ *
+ * The reader groups records into batches of BATCH_RECORDS and deals
+ * them round-robin onto per-worker deques. A worker takes the oldest
+ * batch from its own deque and, when that is empty, steals the newest
+ * batch from another worker's. Only WINDOW_BATCHES batches are ever in
+ * flight; the reader writes finished batches out in order and reuses
+ * their slots, so memory use does not depend on the input size.
+ *
+ * Per-worker throughput, steal counts and batch latency percentiles are
+ * reported on stderr when the run completes.
+ *
+ * Usage: bulk_derive [-j threads] [-k dklen] [input [output]]
+ *        (stdin/stdout when no files are given)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "isha.h"
+#include "pbkdf1.h"
+
+#define MAX_LINE        512   // longest record line, including newline
+#define BATCH_RECORDS   64    // records per unit of work
+#define WINDOW_BATCHES  64    // batches in flight at once
+#define MAX_WORKERS     256
+#define HIST_BUCKETS    256   // quarter-octave latency buckets
+
+typedef struct {
+	char line[MAX_LINE];
+	Pbkdf1Input in;
+	uint32_t c;
+	error_t err;
+	uint8_t dk[ISHA_DIGESTLEN];
+} Record;
+
+typedef struct {
+	Record rec[BATCH_RECORDS];
+	int count;
+	bool done;                    // protected by done_lock
+} Batch;
+
+/*
+ * Per-worker deque of batch sequence numbers. The owner takes from
+ * top (oldest first, which keeps in-order output flowing), thieves
+ * take from bottom.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	uint64_t items[WINDOW_BATCHES];
+	uint64_t top, bottom;         // items live in [top, bottom)
+} Deque;
+
+typedef struct {
+	pthread_t thread;
+	int id;
+	Deque deque;
+	uint64_t batches, records, steals, busy_ns, max_ns;
+	uint32_t hist[HIST_BUCKETS];
+} Worker;
+
+static Batch window[WINDOW_BATCHES];
+static Worker workers[MAX_WORKERS];
+static int num_workers;
+static size_t dk_len = ISHA_DIGESTLEN;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cv = PTHREAD_COND_INITIALIZER;
+static uint64_t queued;           // batches in deques; protected by pool_lock
+static bool shutting_down;        // protected by pool_lock
+
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done_cv = PTHREAD_COND_INITIALIZER;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void deque_push(Deque *d, uint64_t seq) {
+	pthread_mutex_lock(&d->lock);
+	d->items[d->bottom++ % WINDOW_BATCHES] = seq;
+	pthread_mutex_unlock(&d->lock);
+}
+
+static bool deque_take(Deque *d, uint64_t *seq, bool steal) {
+	bool ok = false;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->top != d->bottom) {
+		*seq = steal ? d->items[--d->bottom % WINDOW_BATCHES]
+				: d->items[d->top++ % WINDOW_BATCHES];
+		ok = true;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return ok;
+}
+
+/*
+ * Finds the next batch for worker w: its own oldest batch, otherwise
+ * one stolen from the other workers. Blocks while there is no work.
+ * Returns false once the pool is shutting down and drained.
+ */
+static bool next_batch(Worker *w, uint64_t *seq) {
+	for (;;) {
+		if (deque_take(&w->deque, seq, false))
+			goto found;
+
+		for (int i = 1; i < num_workers; i++) {
+			Worker *victim = &workers[(w->id + i) % num_workers];
+			if (deque_take(&victim->deque, seq, true)) {
+				w->steals++;
+				goto found;
+			}
+		}
+
+		pthread_mutex_lock(&pool_lock);
+		while (queued == 0 && !shutting_down)
+			pthread_cond_wait(&work_cv, &pool_lock);
+		if (queued == 0 && shutting_down) {
+			pthread_mutex_unlock(&pool_lock);
+			return false;
+		}
+		pthread_mutex_unlock(&pool_lock);
+	}
+
+found:
+	pthread_mutex_lock(&pool_lock);
+	queued--;
+	pthread_mutex_unlock(&pool_lock);
+	return true;
+}
+
+/*
+ * Derives every record of a batch. When all valid records share one
+ * iteration count (the usual provisioning case) they go through
+ * pbkdf1_batch together; otherwise each goes through pbkdf1.
+ */
+static void derive_batch(Batch *b) {
+	Pbkdf1Input in[BATCH_RECORDS];
+	uint8_t dk[BATCH_RECORDS * ISHA_DIGESTLEN];
+	int idx[BATCH_RECORDS], n = 0;
+	bool uniform = true;
+
+	for (int i = 0; i < b->count; i++) {
+		Record *r = &b->rec[i];
+		if (r->err != NO_ERROR)
+			continue;
+		if (n > 0 && r->c != b->rec[idx[0]].c)
+			uniform = false;
+		in[n] = r->in;
+		idx[n++] = i;
+	}
+
+	if (n > 0 && uniform
+			&& pbkdf1_batch(in, n, b->rec[idx[0]].c, dk, dk_len) == NO_ERROR) {
+		for (int i = 0; i < n; i++)
+			memcpy(b->rec[idx[i]].dk, dk + i * dk_len, dk_len);
+		return;
+	}
+
+	for (int i = 0; i < n; i++) {
+		Record *r = &b->rec[idx[i]];
+		r->err = pbkdf1(r->in.p, r->in.pLen, r->in.s, r->in.sLen, r->c, r->dk,
+				dk_len);
+	}
+}
+
+static void record_latency(Worker *w, uint64_t ns) {
+	int bucket = ns ? (int) (4 * log2((double) ns)) : 0;
+
+	if (bucket >= HIST_BUCKETS)
+		bucket = HIST_BUCKETS - 1;
+	w->hist[bucket]++;
+	if (ns > w->max_ns)
+		w->max_ns = ns;
+}
+
+/*
+ * Returns the upper bound, in ns, of the bucket holding percentile p,
+ * capped at the largest latency actually seen
+ */
+static double percentile(const Worker *w, double p) {
+	uint64_t target = (uint64_t) ceil(p / 100 * w->batches), seen = 0;
+
+	for (int i = 0; i < HIST_BUCKETS; i++) {
+		seen += w->hist[i];
+		if (seen >= target && seen > 0)
+			return fmin(pow(2, (i + 1) / 4.0), (double) w->max_ns);
+	}
+	return 0;
+}
+
+static void *worker_main(void *arg) {
+	Worker *w = arg;
+	uint64_t seq;
+
+	while (next_batch(w, &seq)) {
+		Batch *b = &window[seq % WINDOW_BATCHES];
+		uint64_t start = now_ns(), elapsed;
+
+		derive_batch(b);
+
+		elapsed = now_ns() - start;
+		w->batches++;
+		w->records += b->count;
+		w->busy_ns += elapsed;
+		record_latency(w, elapsed);
+
+		pthread_mutex_lock(&done_lock);
+		b->done = true;
+		pthread_cond_broadcast(&done_cv);
+		pthread_mutex_unlock(&done_lock);
+	}
+	return NULL;
+}
+
+/*
+ * Splits r->line into password, salt and iteration count
+ */
+static void parse_record(Record *r) {
+	char *line = r->line, *tab1, *tab2, *end;
+	size_t len = strlen(line);
+	unsigned long c;
+
+	if (len > 0 && line[len - 1] == '\n')
+		line[--len] = '\0';
+	if (len > 0 && line[len - 1] == '\r')
+		line[--len] = '\0';
+
+	tab1 = strchr(line, '\t');
+	tab2 = tab1 ? strchr(tab1 + 1, '\t') : NULL;
+	if (!tab2) {
+		r->err = ERROR_INVALID_SYNTAX;
+		return;
+	}
+	*tab1 = *tab2 = '\0';
+
+	c = strtoul(tab2 + 1, &end, 10);
+	if (end == tab2 + 1 || *end != '\0' || c < 1 || c > UINT32_MAX) {
+		r->err = ERROR_INVALID_PARAMETER;
+		return;
+	}
+
+	r->in.p = (const uint8_t *) line;
+	r->in.pLen = tab1 - line;
+	r->in.s = (const uint8_t *) tab1 + 1;
+	r->in.sLen = tab2 - tab1 - 1;
+	r->c = c;
+	r->err = NO_ERROR;
+}
+
+/*
+ * Reads up to BATCH_RECORDS records into b. Returns false at end of
+ * input with nothing read.
+ */
+static bool read_batch(FILE *in, Batch *b) {
+	b->count = 0;
+	b->done = false;
+
+	while (b->count < BATCH_RECORDS) {
+		Record *r = &b->rec[b->count];
+		size_t len;
+
+		if (!fgets(r->line, sizeof(r->line), in))
+			break;
+
+		len = strlen(r->line);
+		if (len == sizeof(r->line) - 1 && r->line[len - 1] != '\n') {
+			int ch;
+			while ((ch = fgetc(in)) != EOF && ch != '\n')
+				;  // discard the rest of an overlong line
+			r->err = ERROR_INVALID_LENGTH;
+		} else {
+			parse_record(r);
+		}
+		b->count++;
+	}
+	return b->count > 0;
+}
+
+static void write_batch(FILE *out, const Batch *b) {
+	static const char hex[] = "0123456789abcdef";
+	char line[2 * ISHA_DIGESTLEN + 2];
+
+	for (int i = 0; i < b->count; i++) {
+		const Record *r = &b->rec[i];
+
+		if (r->err != NO_ERROR) {
+			fprintf(out, "ERROR %d\n", r->err);
+			continue;
+		}
+		for (size_t j = 0; j < dk_len; j++) {
+			line[2 * j] = hex[r->dk[j] >> 4];
+			line[2 * j + 1] = hex[r->dk[j] & 0xF];
+		}
+		line[2 * dk_len] = '\n';
+		fwrite(line, 1, 2 * dk_len + 1, out);
+	}
+}
+
+static void wait_done(const Batch *b) {
+	pthread_mutex_lock(&done_lock);
+	while (!b->done)
+		pthread_cond_wait(&done_cv, &done_lock);
+	pthread_mutex_unlock(&done_lock);
+}
+
+static void print_report(uint64_t elapsed_ns) {
+	uint64_t total = 0;
+
+	fprintf(stderr, "worker,batches,records,steals,busy_s,records_per_sec,"
+			"p50_batch_us,p99_batch_us,max_batch_us\n");
+	for (int i = 0; i < num_workers; i++) {
+		const Worker *w = &workers[i];
+		double busy = w->busy_ns / 1e9;
+
+		fprintf(stderr, "%d,%lu,%lu,%lu,%.3f,%.1f,%.1f,%.1f,%.1f\n", i,
+				(unsigned long) w->batches, (unsigned long) w->records,
+				(unsigned long) w->steals, busy,
+				busy > 0 ? w->records / busy : 0.0, percentile(w, 50) / 1e3,
+				percentile(w, 99) / 1e3, w->max_ns / 1e3);
+		total += w->records;
+	}
+	fprintf(stderr, "total,%lu records in %.3f s,%.1f records/s\n",
+			(unsigned long) total, elapsed_ns / 1e9,
+			elapsed_ns ? total * 1e9 / elapsed_ns : 0.0);
+}
+
+int main(int argc, char **argv) {
+	FILE *in = stdin, *out = stdout;
+	uint64_t next_read = 0, next_write = 0, start;
+	bool eof = false;
+	int opt;
+
+	num_workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((opt = getopt(argc, argv, "j:k:")) != -1) {
+		switch (opt) {
+		case 'j':
+			num_workers = atoi(optarg);
+			break;
+		case 'k':
+			dk_len = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (num_workers < 1)
+		num_workers = 1;
+	if (num_workers > MAX_WORKERS)
+		num_workers = MAX_WORKERS;
+	if (dk_len < 1 || dk_len > ISHA_DIGESTLEN)
+		goto usage;
+
+	if (optind < argc && !(in = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if (optind + 1 < argc && !(out = fopen(argv[optind + 1], "w"))) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	for (int i = 0; i < num_workers; i++) {
+		workers[i].id = i;
+		pthread_mutex_init(&workers[i].deque.lock, NULL);
+		pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+	}
+
+	start = now_ns();
+	while (!eof || next_write < next_read) {
+		Batch *oldest = &window[next_write % WINDOW_BATCHES];
+
+		if (!eof && next_read - next_write < WINDOW_BATCHES) {
+			Batch *b = &window[next_read % WINDOW_BATCHES];
+
+			if (!read_batch(in, b)) {
+				eof = true;
+				continue;
+			}
+			deque_push(&workers[next_read % num_workers].deque, next_read);
+
+			pthread_mutex_lock(&pool_lock);
+			queued++;
+			pthread_cond_signal(&work_cv);
+			pthread_mutex_unlock(&pool_lock);
+			next_read++;
+			continue;
+		}
+
+		wait_done(oldest);
+		write_batch(out, oldest);
+		next_write++;
+	}
+
+	pthread_mutex_lock(&pool_lock);
+	shutting_down = true;
+	pthread_cond_broadcast(&work_cv);
+	pthread_mutex_unlock(&pool_lock);
+	for (int i = 0; i < num_workers; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	fflush(out);
+	print_report(now_ns() - start);
+
+	if (in != stdin)
+		fclose(in);
+	if (out != stdout)
+		fclose(out);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-j threads] [-k dklen] [input [output]]\n",
+			argv[0]);
+	return 1;
+}
@@ -0,0 +1,174 @@
+/*
+ * fastdiv_tests.c
+ *
+ * Exhaustive host tests for fastdiv.h: every 32-bit dividend of
+ * udiv10() and umod10(), through both the 64-bit and the 16x16
+ * fastdiv_mulhi16() high multiply the target uses; every input the
+ * ticktime and Set_RGB reciprocals can see; and every dividend below
+ * 2^n of every divisor up to 1000 for which FASTDIV_EXACT and
+ * FASTDIV_FITS32 accept a shift. Exits non-zero if any test fails.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "fastdiv.h"
+
+#define SWEEP_MAX_DIVISOR 1000
+
+static uint32_t rng_state = 0x2545F491;
+
+/*
+ * xorshift32, so the sequence is the same on every run
+ */
+static uint32_t rng(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+/*
+ * udiv10() for every x, as the target computes it: with the 16x16
+ * fastdiv_mulhi16(). The host build of udiv10() and umod10() uses a
+ * 64-bit product instead, and is checked on small and random values.
+ * The expected quotient is counted rather than divided, to keep the
+ * 2^32 iterations quick.
+ */
+static bool test_div10(void) {
+	const uint32_t m = (uint32_t) FASTDIV_M(1, 10, 35);
+	uint32_t x = 0, q = 0, r = 0, i;
+
+	do {
+		if (fastdiv_mulhi16(x, m) >> 3 != q) {
+			printf("udiv10(%u) = %u\r\n", x, fastdiv_mulhi16(x, m) >> 3);
+			return false;
+		}
+		if (++r == 10) {
+			r = 0;
+			q++;
+		}
+	} while (++x != 0);
+
+	for (i = 0; i < 1000000; i++) {
+		x = i < 500000 ? i : rng();
+		if (udiv10(x) != x / 10 || umod10(x) != x % 10)
+			return false;
+	}
+	return udiv10(UINT32_MAX) == UINT32_MAX / 10 && umod10(UINT32_MAX) == 5;
+}
+
+/*
+ * fastdiv_mulhi16() against a 64-bit product, at the edges and at random
+ */
+static bool test_mulhi(void) {
+	static const uint32_t edges[] = { 0, 1, 0xFFFF, 0x10000, 0x7FFFFFFF,
+			0x80000000, 0xFFFF0000, 0xFFFFFFFF };
+	uint32_t a, b, i, j;
+
+	for (i = 0; i < 8; i++) {
+		for (j = 0; j < 8; j++) {
+			a = edges[i];
+			b = edges[j];
+			if (fastdiv_mulhi16(a, b) != (uint32_t) (((uint64_t) a * b) >> 32))
+				return false;
+		}
+	}
+	for (i = 0; i < 10000000; i++) {
+		a = rng();
+		b = rng();
+		if (fastdiv_mulhi16(a, b) != (uint32_t) (((uint64_t) a * b) >> 32))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * The instances used in the firmware, over the whole input range each
+ * one is given
+ */
+FASTDIV_CHECK(1, 48, 19, 15);
+FASTDIV_CHECK(625, 255, 16, 8);
+FASTDIV_CHECK(1200, 255, 16, 8);
+
+static bool test_adopted(void) {
+	uint32_t x;
+
+	for (x = 0; x < 1u << 15; x++) {              // ticktime.c: cycles to usec
+		if (UDIV_CONST(x, 48, 19) != x / 48 || UMOD_CONST(x, 48, 19) != x % 48)
+			return false;
+	}
+	for (x = 0; x < 256; x++) {                   // led.c: Set_RGB()
+		if (UMULDIV_CONST(x, 625, 255, 16) != x * 625 / 255
+				|| UMULDIV_CONST(x, 1200, 255, 16) != x * 1200 / 255)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * For each divisor and input width, the smallest shift the checks
+ * accept must really be exact for every input. Returns the number of
+ * (divisor, width) pairs tested, or -1 on a mismatch.
+ */
+static int sweep(void) {
+	static const uint32_t widths[] = { 8, 12, 16 };
+	uint32_t d, i, s, n, x;
+	int tested = 0;
+
+	for (d = 1; d <= SWEEP_MAX_DIVISOR; d++) {
+		for (i = 0; i < 3; i++) {
+			n = widths[i];
+			for (s = 0; s < 48; s++) {
+				if (FASTDIV_EXACT(1, d, s, n) && FASTDIV_FITS32(1, d, s, n))
+					break;
+			}
+			if (s == 48)
+				continue;
+			for (x = 0; x < 1u << n; x++) {
+				if (UDIV_CONST(x, d, s) != x / d) {
+					printf("x = %u, d = %u, s = %u: %u\r\n", x, d, s,
+							UDIV_CONST(x, d, s));
+					return -1;
+				}
+			}
+			tested++;
+		}
+	}
+	return tested;
+}
+
+int main(void) {
+	int test = 0, tests_passed = 0, tested;
+	bool ok;
+
+	ok = test_mulhi();
+	printf("fastdiv test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	ok = test_div10();
+	printf("fastdiv test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	ok = test_adopted();
+	printf("fastdiv test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Every 8- and 12-bit case has a shift; most 16-bit ones do too
+	tested = sweep();
+	ok = tested >= 2 * SWEEP_MAX_DIVISOR;
+	printf("fastdiv test %d: %s (%d divisor/width pairs)\r\n", test,
+			ok ? "success" : "FAILURE", tested);
+	tests_passed += ok;
+	test++;
+
+	if (test != tests_passed) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+	printf("All tests passed!\r\n");
+	return 0;
+}
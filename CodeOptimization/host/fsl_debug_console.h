@@ -0,0 +1,15 @@
+/*
+ * fsl_debug_console.h
+ *
+ * Host stand-in for the SDK debug console so that the ISHA/PBKDF1 core
+ * and its tests build off-target. PRINTF goes straight to stdout.
+ */
+
+#ifndef _FSL_DEBUG_CONSOLE_H_
+#define _FSL_DEBUG_CONSOLE_H_
+
+#include <stdio.h>
+
+#define PRINTF printf
+
+#endif /* _FSL_DEBUG_CONSOLE_H_ */
@@ -0,0 +1,119 @@
+/*
+ * func_trace_tests.c
+ *
+ * Checks the -finstrument-functions event ring on the host. Built with
+ * FUNC_TRACE and -finstrument-functions, so the hooks in func_trace.c
+ * see every call in this file. Writes a trace of one call to outer() to
+ * the file named on the command line for profdecode.py --ftrace. Exits
+ * non-zero if any test fails.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "func_trace.h"
+#include "ticktime.h"
+
+static volatile uint32_t sink;
+
+static void __attribute__((noinline)) inner(uint32_t n) {
+	for (uint32_t i = 0; i < n; i++)
+		sink += i;
+}
+
+static void __attribute__((noinline)) outer(uint32_t n) {
+	inner(n);
+	inner(n);
+}
+
+static uint32_t addr(void (*fn)(uint32_t)) {
+	return (uint32_t) (uintptr_t) fn;
+}
+
+static bool is_event(uint32_t seq, void (*fn)(uint32_t), uint32_t exit) {
+	return func_trace.event[seq & (FUNC_TRACE_LEN - 1)][0] == (addr(fn) | exit);
+}
+
+/*
+ * Checks that events first..first+5 are one call to outer()
+ */
+static bool is_outer_call(uint32_t first) {
+	uint32_t i;
+
+	for (i = first; i < first + 5; i++) {
+		if ((int32_t) (func_trace.event[(i + 1) & (FUNC_TRACE_LEN - 1)][1]
+				- func_trace.event[i & (FUNC_TRACE_LEN - 1)][1]) < 0)
+			return false;
+	}
+	return is_event(first, outer, 0) && is_event(first + 1, inner, 0)
+			&& is_event(first + 2, inner, FUNC_TRACE_EXIT)
+			&& is_event(first + 3, inner, 0)
+			&& is_event(first + 4, inner, FUNC_TRACE_EXIT)
+			&& is_event(first + 5, outer, FUNC_TRACE_EXIT);
+}
+
+int main(int argc, char **argv) {
+	int test = 0, tests_passed = 0;
+	uint32_t i;
+	bool ok;
+
+	init_ticktime();
+
+	// Nothing is recorded while off; one call is six events in order
+	func_trace_reset(false);
+	outer(10);
+	func_trace_enable(true);
+	outer(1000);
+	func_trace_enable(false);
+	outer(10);
+	ok = func_trace.count == 6 && is_outer_call(0)
+			&& func_trace.event[5][1] - func_trace.event[0][1] > 0;
+	printf("func_trace test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Without wrap, the oldest events stay and the rest are counted as lost
+	func_trace_reset(false);
+	func_trace_enable(true);
+	for (i = 0; i < FUNC_TRACE_LEN; i++)
+		outer(1);
+	func_trace_enable(false);
+	ok = func_trace.count == 6 * FUNC_TRACE_LEN && is_outer_call(0)
+			&& is_outer_call(6 * (FUNC_TRACE_LEN / 6 - 1));
+	printf("func_trace test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// With wrap, the newest events stay
+	func_trace_reset(true);
+	func_trace_enable(true);
+	for (i = 0; i < FUNC_TRACE_LEN + 1; i++)
+		outer(1);
+	func_trace_enable(false);
+	ok = func_trace.count == 6 * (FUNC_TRACE_LEN + 1)
+			&& is_outer_call(func_trace.count - 6);
+	printf("func_trace test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	if (argc > 1) {
+		FILE *f = fopen(argv[1], "wb");
+		func_trace_reset(false);
+		func_trace_enable(true);
+		outer(1000);
+		func_trace_enable(false);
+		if (!f || fwrite(&func_trace, sizeof(func_trace), 1, f) != 1) {
+			perror(argv[1]);
+			return 1;
+		}
+		fclose(f);
+	}
+
+	if (test != tests_passed) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+	printf("All tests passed!\r\n");
+	return 0;
+}
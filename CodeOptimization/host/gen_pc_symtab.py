@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+gen_pc_symtab.py
+
+Generates the sorted address-range table the PC profiler searches, from
+the GNU ld map file of a firmware build. The output is a complete
+pc_symtab.c, which source/pc_symtab.c includes as pc_symtab.inc when
+that is in the build directory.
+
+Every code input section (.text*, .after_vectors*, and the .ramfunc*
+sections RAMFUNC places in .data) becomes one or more entries: one per
+symbol the map lists inside it, or, when it lists none (static functions
+built with -ffunction-sections), one entry named after the section
+itself. The map gives input sections at their run addresses, so
+.ramfunc* code is entered at its SRAM address, where the PC is when it
+runs, not at its load image in flash.
+
+The map only lists global symbols. Every RAMFUNC function of a file
+shares one .ramfunc.$RAM section, so a static one there is counted
+under the global symbol ahead of it, or under the section's name if it
+comes first.
+
+The table only holds data, and the code sections come first in the
+image, so regenerating it does not move any function. The Debug
+post-build step writes it to Debug/pc_symtab.inc and, when it changed,
+links again, so the image it leaves has the table of its own map. By
+hand:
+
+    python3 host/gen_pc_symtab.py Debug/PBKDF1.map > Debug/pc_symtab.inc
+
+Usage: gen_pc_symtab.py [-m max_entries] mapfile
+"""
+
+import argparse
+import os
+import re
+import sys
+
+CODE_SECTION = re.compile(r'^ (\.text\S*|\.after_vectors\S*|\.ramfunc\S*)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$')
+SECTION_ADDR = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+OTHER_SECTION = re.compile(r'^ \S')
+SYMBOL = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_.$][\w.$]*)\s*$')
+OUTPUT_SECTION = re.compile(r'^\S')
+FUNCTION_SECTION = re.compile(r'^\.(?:text|ramfunc\.\$\w+)\.(.+)$')
+
+
+def parse_map(lines):
+    """Returns [(start, end, name)] for every code range in the map."""
+    ranges = []
+    in_map = False
+    section = None          # [name, start, size, file, [(addr, symbol)]]
+    pending = None          # code section whose address is on the next line
+
+    def close():
+        if section is None or section[2] == 0:
+            return
+        name, start, size, path, symbols = section
+        end = start + size
+        symbols = sorted(s for s in symbols if start <= s[0] < end)
+        function = FUNCTION_SECTION.match(name)
+        anonymous = '%s(%s)' % (os.path.basename(path), name)
+        if symbols:
+            # Ahead of the first symbol is padding in a section named
+            # after its function, a static function in a shared one
+            if function is None and symbols[0][0] > start:
+                ranges.append((start, symbols[0][0], anonymous))
+            for i, (addr, sym) in enumerate(symbols):
+                stop = symbols[i + 1][0] if i + 1 < len(symbols) else end
+                if stop > addr:
+                    ranges.append((addr, stop, sym))
+        elif function is not None:
+            ranges.append((start, end, function.group(1)))
+        else:
+            ranges.append((start, end, anonymous))
+
+    for line in lines:
+        line = line.rstrip('\n')
+        if not in_map:
+            in_map = line.startswith('Linker script and memory map')
+            continue
+
+        if pending is not None:
+            m = SECTION_ADDR.match(line)
+            if m:
+                section = [pending, int(m.group(1), 16), int(m.group(2), 16),
+                           m.group(3), []]
+            pending = None
+            continue
+
+        m = CODE_SECTION.match(line)
+        if m:
+            close()
+            section = None
+            if m.group(2) is None:
+                pending = m.group(1)
+            else:
+                section = [m.group(1), int(m.group(2), 16), int(m.group(3), 16),
+                           m.group(4), []]
+            continue
+
+        if OTHER_SECTION.match(line) or OUTPUT_SECTION.match(line):
+            close()
+            section = None
+            continue
+
+        m = SYMBOL.match(line)
+        if m and section is not None:
+            section[4].append((int(m.group(1), 16), m.group(2)))
+
+    close()
+
+    # Thumb bit off, sorted, no empty or overlapping entries
+    ranges = sorted((s & ~1, e & ~1, n) for s, e, n in ranges)
+    table = []
+    for start, end, name in ranges:
+        if table and start < table[-1][1]:
+            continue
+        if end > start:
+            table.append((start, end, name))
+    return table
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Generate pc_symtab.c from a GNU ld map')
+    ap.add_argument('-m', '--max', type=int, default=256,
+                    help='PC_SYMTAB_MAX in pc_symtab.h (default 256)')
+    ap.add_argument('mapfile')
+    args = ap.parse_args()
+
+    with open(args.mapfile) as f:
+        table = parse_map(f)
+
+    if len(table) > args.max:
+        sys.exit('%s: %d functions, more than PC_SYMTAB_MAX (%d)'
+                 % (args.mapfile, len(table), args.max))
+
+    out = sys.stdout
+    out.write('/*\n * pc_symtab.c\n *\n'
+              ' * Generated by host/gen_pc_symtab.py from %s; do not edit.\n'
+              ' */\n\n#include <stddef.h>\n#include "pc_symtab.h"\n\n'
+              % os.path.basename(args.mapfile))
+    out.write('const PCSymbol pc_symtab[] = {\n')
+    for start, end, name in table:
+        out.write('\t{ 0x%08X, 0x%08X, "%s" },\n' % (start, end, name))
+    if not table:
+        out.write('\t{ 0, 0, NULL },\n')
+    out.write('};\n\nconst uint16_t pc_symtab_len = %d;\n' % len(table))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,61 @@
+/*
+ * host_tests.c
+ *
+ * Runs the ISHA/PBKDF1 validity tests from pbkdf1_test.c on the host.
+ * Exits non-zero if any test fails.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "pbkdf1_test.h"
+#include "pbkdf2_parallel.h"
+#include "ticktime.h"
+
+/*
+ * Checks that pbkdf2_parallel gives the same key as pbkdf2 for any
+ * thread count, including a key that ends in a partial block
+ */
+static bool test_pbkdf2_parallel(void) {
+	static const int threads[] = { 1, 2, 3, 8 };
+	uint8_t exp[210], act[210];
+	int test, tests_passed = 0;
+
+	pbkdf2(&ishaHashAlgo, (const uint8_t *) "Boulder", 7,
+			(const uint8_t *) "Buffaloes", 9, 100, exp, sizeof(exp));
+
+	for (test = 0; test < 4; test++) {
+		if (pbkdf2_parallel(&ishaHashAlgo, (const uint8_t *) "Boulder", 7,
+				(const uint8_t *) "Buffaloes", 9, 100, act, sizeof(act),
+				threads[test]) == NO_ERROR && cmp_bin(act, exp, sizeof(exp))) {
+			printf("%s test %d: success\r\n", __FUNCTION__, test);
+			tests_passed++;
+		} else {
+			printf("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+		}
+	}
+	return tests_passed == test;
+}
+
+int main(void) {
+	bool success = true;
+
+	init_ticktime();
+
+	success &= test_isha();
+	success &= test_pbkdf1();
+	success &= test_isha_multi();
+	success &= test_pbkdf1_batch();
+	success &= test_isha_tree();
+	success &= test_pbkdf2();
+	success &= test_pbkdf2_parallel();
+	success &= test_pbkdf1_calibrate();
+
+	if (!success) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+
+	printf("All tests passed!\r\n");
+	return 0;
+}
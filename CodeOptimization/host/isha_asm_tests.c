@@ -0,0 +1,144 @@
+/*
+ * isha_asm_tests.c
+ *
+ * Differential test of the Thumb-1 block kernel in ISHACompressBlock.S,
+ * both entry points, against the C reference ISHACompressBlock(), on
+ * random chaining values and blocks, plus the digest tests from pbkdf1_test.c with the
+ * kernel switched in (ISHA_ASM_BLOCK=1). It is built with an ARM Linux
+ * cross compiler and run under user-mode QEMU by make check-arm; the
+ * kernel only uses ARMv6-M instructions, which every ARM Linux CPU
+ * runs in Thumb state. Exits non-zero if any test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "isha.h"
+#include "pbkdf1_test.h"
+
+#define RANDOM_BLOCKS 100000
+
+static uint32_t rng_state = 0x2545F491;
+
+/*
+ * xorshift32, so the sequence is the same on every run
+ */
+static uint32_t rng(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+/*
+ * Runs both versions on one input. Returns true if they agree.
+ */
+static bool compare(const uint32_t *md, const uint8_t *block) {
+	uint32_t c[5], a[5];
+
+	memcpy(c, md, sizeof(c));
+	memcpy(a, md, sizeof(a));
+	ISHACompressBlock(c, block);
+	ISHACompressBlockAsm(a, block);
+	if (!memcmp(c, a, sizeof(c)))
+		return true;
+
+	printf("mismatch: C %08x %08x %08x %08x %08x, asm %08x %08x %08x %08x %08x\r\n",
+			c[0], c[1], c[2], c[3], c[4], a[0], a[1], a[2], a[3], a[4]);
+	return false;
+}
+
+/*
+ * Runs ISHACompressWordsAsm on host-order words against the C version
+ * on the same words as big-endian bytes. Returns true if they agree.
+ */
+static bool compare_words(const uint32_t *md, const uint32_t *words) {
+	uint32_t c[5], a[5];
+	uint8_t block[64];
+	int j;
+
+	for (j = 0; j < 16; j++) {
+		block[4 * j] = words[j] >> 24;
+		block[4 * j + 1] = words[j] >> 16;
+		block[4 * j + 2] = words[j] >> 8;
+		block[4 * j + 3] = words[j];
+	}
+	memcpy(c, md, sizeof(c));
+	memcpy(a, md, sizeof(a));
+	ISHACompressBlock(c, block);
+	ISHACompressWordsAsm(a, words);
+	if (!memcmp(c, a, sizeof(c)))
+		return true;
+
+	printf("words mismatch: C %08x %08x %08x %08x %08x, asm %08x %08x %08x %08x %08x\r\n",
+			c[0], c[1], c[2], c[3], c[4], a[0], a[1], a[2], a[3], a[4]);
+	return false;
+}
+
+int main(void) {
+	uint32_t words[16], md[5];
+	uint8_t *block = (uint8_t *) words;
+	int test = 0, tests_passed = 0;
+	bool ok = true;
+	int i, j;
+
+	// Random chaining values and blocks
+	for (i = 0; i < RANDOM_BLOCKS && ok; i++) {
+		for (j = 0; j < 5; j++)
+			md[j] = rng();
+		for (j = 0; j < 16; j++)
+			words[j] = rng();
+		ok = compare(md, block);
+	}
+	printf("isha_asm test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// The word-input entry point, on random chaining values and words
+	ok = true;
+	for (i = 0; i < RANDOM_BLOCKS && ok; i++) {
+		for (j = 0; j < 5; j++)
+			md[j] = rng();
+		for (j = 0; j < 16; j++)
+			words[j] = rng();
+		ok = compare_words(md, words);
+	}
+	printf("isha_asm test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Edge values: all zero bits, all one bits, and the ISHA IV
+	memset(md, 0, sizeof(md));
+	memset(words, 0, sizeof(words));
+	ok = compare(md, block);
+	memset(md, 0xFF, sizeof(md));
+	memset(words, 0xFF, sizeof(words));
+	ok = ok && compare(md, block);
+	md[0] = ISHA_H0;
+	md[1] = ISHA_H1;
+	md[2] = ISHA_H2;
+	md[3] = ISHA_H3;
+	md[4] = ISHA_H4;
+	for (j = 0; j < 64; j++)
+		block[j] = j;
+	ok = ok && compare(md, block);
+	printf("isha_asm test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// The whole hash with the kernel in ISHAProcessMessageBlock, and
+	// PBKDF1's inner loop with it in isha_rehash_digest
+	ok = test_isha() && test_pbkdf1();
+	printf("isha_asm test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	if (test != tests_passed) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+	printf("All tests passed!\r\n");
+	return 0;
+}
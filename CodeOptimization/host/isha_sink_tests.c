@@ -0,0 +1,88 @@
+/*
+ * isha_sink_tests.c
+ *
+ * Host tests for isha_sink.c: streams of various lengths are fed into
+ * rx_buffer in random-sized pieces, as the UART interrupt would, with
+ * isha_sink_poll() called in between, and the digest is compared with
+ * hashing the whole stream at once. Exits non-zero if any test fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "isha_sink.h"
+
+#define MAX_STREAM 10000
+
+static const uint32_t lengths[] = { 0, 1, 63, 64, 65, 127, 128, 1000, MAX_STREAM };
+
+static uint32_t rng_state = 0x2545F491;
+
+/*
+ * xorshift32, so the sequence is the same on every run
+ */
+static uint32_t rng(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+/*
+ * Streams length bytes, plus extra trailing bytes that belong to
+ * whatever follows, through rx_buffer into a sink. Returns true if the
+ * digest matches and the trailing bytes are left in the ring.
+ */
+static bool stream(uint32_t length, uint32_t extra) {
+	static uint8_t data[MAX_STREAM + 16];
+	uint8_t expected[ISHA_DIGESTLEN];
+	ISHAContext ctx;
+	IshaSink sink;
+	uint32_t sent = 0, total = length + extra, n;
+	bool done = false;
+
+	for (n = 0; n < total; n++)
+		data[n] = rng();
+	ISHAReset(&ctx);
+	ISHAInput(&ctx, data, length);
+	ISHAResult(&ctx, expected);
+
+	cbfifo_reset(&rx_buffer);
+	isha_sink_init(&sink, length);
+	while (!done) {
+		n = rng() % 200;
+		if (n > total - sent)
+			n = total - sent;
+		sent += cbfifo_enqueue(&rx_buffer, data + sent, n);
+		done = isha_sink_poll(&sink, &rx_buffer);
+		if (!done && sent == total && cbfifo_length(&rx_buffer) == cbfifo_capacity()) {
+			printf("sink stalled at %u of %u bytes\r\n", sink.bytes, length);
+			return false;
+		}
+	}
+
+	return sink.bytes == length
+			&& !memcmp(sink.digest, expected, ISHA_DIGESTLEN)
+			&& cbfifo_length(&rx_buffer) == sent - length;
+}
+
+int main(void) {
+	int test = 0, tests_passed = 0;
+	bool ok;
+	size_t i;
+
+	for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		ok = stream(lengths[i], 0) && stream(lengths[i], 1 + rng() % 16);
+		printf("isha_sink test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+		tests_passed += ok;
+		test++;
+	}
+
+	if (test != tests_passed) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+	printf("All tests passed!\r\n");
+	return 0;
+}
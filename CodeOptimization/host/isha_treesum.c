@@ -0,0 +1,194 @@
+/*
+ * isha_treesum.c
+ *
+ * Prints the ISHA-Tree digest of each file named on the command line.
+ * The file is memory-mapped and its leaves are hashed by a pool of
+ * threads, which take leaves from a shared counter; the leaf hashes
+ * are then folded into the tree in order.
+ *
+ * Usage: isha_treesum [-j threads] [-p] [-v] file...
+ *        -p prints the plain ISHA digest instead, as isha_sink computes
+ *           for an upload over the UART
+ *        -v reports the hashing throughput on stderr
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "isha_tree.h"
+
+#define MAX_THREADS 256
+
+typedef struct {
+	const uint8_t *data;
+	uint64_t length, leaves;
+	uint8_t (*digests)[ISHA_DIGESTLEN];
+	atomic_uint_fast64_t next;        // next leaf to be taken
+} Job;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t leaf_len(const Job *job, uint64_t i) {
+	uint64_t left = job->length - i * ISHA_TREE_LEAFLEN;
+	return left < ISHA_TREE_LEAFLEN ? left : ISHA_TREE_LEAFLEN;
+}
+
+static void *hash_leaves(void *arg) {
+	Job *job = arg;
+	uint64_t i;
+
+	while ((i = atomic_fetch_add(&job->next, 1)) < job->leaves) {
+		isha_tree_leaf(job->data + i * ISHA_TREE_LEAFLEN, leaf_len(job, i),
+				job->digests[i]);
+	}
+	return NULL;
+}
+
+/*
+ * Computes the plain ISHA digest of path. Returns false on I/O errors.
+ */
+static bool plain_hash_file(const char *path, uint8_t *digest_out) {
+	uint8_t buf[65536];
+	ISHAContext ctx;
+	FILE *f;
+	size_t n;
+	bool ok;
+
+	if (!(f = fopen(path, "rb"))) {
+		perror(path);
+		return false;
+	}
+	ISHAReset(&ctx);
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		ISHAInput(&ctx, buf, n);
+	ok = !ferror(f);
+	if (!ok)
+		perror(path);
+	fclose(f);
+	ISHAResult(&ctx, digest_out);
+	return ok;
+}
+
+/*
+ * Computes the ISHA-Tree digest of path. Returns false on I/O errors.
+ */
+static bool tree_hash_file(const char *path, int threads, bool verbose,
+		uint8_t *digest_out) {
+	pthread_t tid[MAX_THREADS];
+	ISHATreeContext ctx;
+	struct stat st;
+	Job job = { 0 };
+	uint64_t start = now_ns(), elapsed;
+	int fd, t;
+
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		perror(path);
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+
+	job.length = st.st_size;
+	job.leaves = (job.length + ISHA_TREE_LEAFLEN - 1) / ISHA_TREE_LEAFLEN;
+	atomic_init(&job.next, 0);
+
+	if (job.length > 0) {
+		job.data = mmap(NULL, job.length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (job.data == MAP_FAILED) {
+			perror(path);
+			close(fd);
+			return false;
+		}
+		job.digests = malloc(job.leaves * ISHA_DIGESTLEN);
+		if (!job.digests) {
+			perror(path);
+			munmap((void *) job.data, job.length);
+			close(fd);
+			return false;
+		}
+
+		if (threads > job.leaves)
+			threads = job.leaves;
+		for (t = 0; t < threads; t++)
+			pthread_create(&tid[t], NULL, hash_leaves, &job);
+		for (t = 0; t < threads; t++)
+			pthread_join(tid[t], NULL);
+	}
+
+	ISHATreeReset(&ctx);
+	for (uint64_t i = 0; i < job.leaves; i++)
+		ISHATreeAddLeaf(&ctx, job.digests[i], leaf_len(&job, i));
+	ISHATreeResult(&ctx, digest_out);
+
+	elapsed = now_ns() - start;
+	if (verbose) {
+		fprintf(stderr, "%s: %llu bytes, %llu leaves, %d threads, %.3f s, %.1f MB/s\n",
+				path, (unsigned long long) job.length,
+				(unsigned long long) job.leaves, threads, elapsed / 1e9,
+				elapsed ? job.length * 1e3 / elapsed : 0.0);
+	}
+
+	if (job.length > 0) {
+		free(job.digests);
+		munmap((void *) job.data, job.length);
+	}
+	close(fd);
+	return true;
+}
+
+int main(int argc, char **argv) {
+	int threads = (int) sysconf(_SC_NPROCESSORS_ONLN), opt, status = 0;
+	bool verbose = false, plain = false;
+	uint8_t digest[ISHA_DIGESTLEN];
+
+	while ((opt = getopt(argc, argv, "j:pv")) != -1) {
+		switch (opt) {
+		case 'j':
+			threads = atoi(optarg);
+			break;
+		case 'p':
+			plain = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind == argc)
+		goto usage;
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+
+	for (int i = optind; i < argc; i++) {
+		if (plain ? !plain_hash_file(argv[i], digest)
+				: !tree_hash_file(argv[i], threads, verbose, digest)) {
+			status = 1;
+			continue;
+		}
+		for (int j = 0; j < ISHA_DIGESTLEN; j++)
+			printf("%02x", digest[j]);
+		printf("  %s\n", argv[i]);
+	}
+	return status;
+
+usage:
+	fprintf(stderr, "usage: %s [-j threads] [-p] [-v] file...\n", argv[0]);
+	return 1;
+}
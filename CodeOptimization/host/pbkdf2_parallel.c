@@ -0,0 +1,88 @@
+/*
+ * pbkdf2_parallel.c
+ *
+ * Host-only PBKDF2 over a thread pool. See pbkdf2_parallel.h.
+ *
+ * Threads take block indices from a shared counter, so uneven thread
+ * speeds still keep every thread busy until the last block.
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "pbkdf2_parallel.h"
+
+#define MAX_THREADS 256
+
+typedef struct {
+	const HmacContext *prf;
+	const uint8_t *s;
+	size_t sLen;
+	uint32_t c;
+	uint8_t *dk;
+	size_t dkLen;
+	uint32_t blocks;
+	atomic_uint next;                 // next block index to be taken, from 1
+} Job;
+
+static void *derive_blocks(void *arg) {
+	Job *job = arg;
+	size_t hLen = job->prf->hash->digestSize, off, n;
+	uint8_t t[HMAC_MAX_DIGEST_SIZE];
+	uint32_t i;
+
+	while ((i = atomic_fetch_add(&job->next, 1)) <= job->blocks) {
+		off = (size_t) (i - 1) * hLen;
+		n = job->dkLen - off < hLen ? job->dkLen - off : hLen;
+		if (n == hLen) {
+			pbkdf2_block(job->prf, job->s, job->sLen, job->c, i, job->dk + off);
+		} else {
+			pbkdf2_block(job->prf, job->s, job->sLen, job->c, i, t);
+			memcpy(job->dk + off, t, n);
+		}
+	}
+	return NULL;
+}
+
+error_t pbkdf2_parallel(const HashAlgo *hash, const uint8_t *p, size_t pLen,
+		const uint8_t *s, size_t sLen, uint32_t c, uint8_t *dk, size_t dkLen,
+		int threads) {
+	pthread_t tid[MAX_THREADS];
+	HmacContext prf;
+	Job job;
+	error_t err;
+	int t;
+
+	if (hash == NULL || p == NULL || s == NULL || dk == NULL || c < 1)
+		return ERROR_INVALID_PARAMETER;
+	if ((uint64_t) dkLen > (uint64_t) 0xFFFFFFFF * hash->digestSize)
+		return ERROR_INVALID_LENGTH;
+
+	err = hmacInit(&prf, hash, p, pLen);
+	if (err)
+		return err;
+
+	job.prf = &prf;
+	job.s = s;
+	job.sLen = sLen;
+	job.c = c;
+	job.dk = dk;
+	job.dkLen = dkLen;
+	job.blocks = (dkLen + hash->digestSize - 1) / hash->digestSize;
+	atomic_init(&job.next, 1);
+
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+	if (threads > (int) job.blocks)
+		threads = job.blocks;
+
+	// The calling thread takes a share too
+	for (t = 1; t < threads; t++)
+		pthread_create(&tid[t], NULL, derive_blocks, &job);
+	derive_blocks(&job);
+	for (t = 1; t < threads; t++)
+		pthread_join(tid[t], NULL);
+
+	return NO_ERROR;
+}
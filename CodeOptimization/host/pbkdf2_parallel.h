@@ -0,0 +1,22 @@
+/*
+ * pbkdf2_parallel.h
+ *
+ * Host-only PBKDF2 that computes the blocks of one long derived key on
+ * several threads at once.
+ */
+
+#ifndef _PBKDF2_PARALLEL_H_
+#define _PBKDF2_PARALLEL_H_
+
+#include "pbkdf1.h"
+
+/*
+ * Same result and error codes as pbkdf2(), with the dkLen / digestSize
+ * output blocks spread over up to threads threads. The HMAC pads are
+ * hashed once and shared by every thread.
+ */
+error_t pbkdf2_parallel(const HashAlgo *hash, const uint8_t *p, size_t pLen,
+		const uint8_t *s, size_t sLen, uint32_t c, uint8_t *dk, size_t dkLen,
+		int threads);
+
+#endif /* _PBKDF2_PARALLEL_H_ */
@@ -0,0 +1,80 @@
+/*
+ * pc_profiler_tests.c
+ *
+ * Checks the PC profiler's symbol lookup and binning on the host,
+ * against a table generated from testdata/sample.map. Exits non-zero
+ * if any test fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "pc_profiler.h"
+#include "pc_symtab.h"
+
+/*
+ * Returns the name pc_symtab_find() resolves pc to, or NULL
+ */
+static const char *lookup(uint32_t pc) {
+	int i = pc_symtab_find(pc);
+	return i < 0 ? NULL : pc_symtab[i].name;
+}
+
+static bool expect(uint32_t pc, const char *name) {
+	const char *got = lookup(pc);
+
+	if ((got == NULL && name == NULL) || (got && name && !strcmp(got, name)))
+		return true;
+	printf("0x%08X: expected %s, got %s\r\n", pc, name ? name : "(none)",
+			got ? got : "(none)");
+	return false;
+}
+
+int main(void) {
+	uint32_t frame[16] = { 0 };
+	int test = 0, tests_passed = 0;
+	bool ok;
+
+	// First and last byte of a range, a static function named after its
+	// section, and the assembly ISHAReset
+	ok = expect(0x440, "ISHAProcessMessageBlock")
+			&& expect(0x4F3, "ISHAProcessMessageBlock")
+			&& expect(0x4F4, "ISHAPadMessage")
+			&& expect(0x410, "ISHAReset")
+			&& expect(0x0C0, "ResetISR")
+			&& expect(0x85B, "main");
+	printf("pc_profiler test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Vector table, fill, flash config, rodata and RAM are not code
+	ok = expect(0x000, NULL) && expect(0x300, NULL) && expect(0x85C, NULL)
+			&& expect(0x1FFFF000, NULL) && expect(0xFFFFFFFF, NULL);
+	printf("pc_profiler test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Samples are binned only while on, with the Thumb bit ignored
+	pc_profile_reset();
+	frame[8] = 0x5AD;
+	pc_profile_check(frame);
+	pc_profile_on();
+	pc_profile_check(frame);
+	pc_profile_check(frame);
+	frame[8] = 0x300;
+	pc_profile_check(frame);
+	pc_profile_off();
+	pc_profile_check(frame);
+	ok = pc_profile_hits(pc_symtab_find(0x5AC)) == 2 && pc_profile_hits(-1) == 1;
+	printf("pc_profiler test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	if (test != tests_passed) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+	printf("All tests passed!\r\n");
+	return 0;
+}
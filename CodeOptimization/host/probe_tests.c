@@ -0,0 +1,129 @@
+/*
+ * probe_tests.c
+ *
+ * Checks the PROBE_SCOPE registry on the host, built with
+ * PROBES_ENABLE=1. Writes the registry to the file named on the command
+ * line for profdecode.py --probes. Exits non-zero if any test fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "probe.h"
+
+static volatile uint32_t sink;
+
+static void spin(uint32_t n) {
+	for (uint32_t i = 0; i < n; i++)
+		sink += i;
+}
+
+static void inner(uint32_t n) {
+	PROBE_SCOPE(inner);
+	spin(n);
+}
+
+static int outer(uint32_t n) {
+	PROBE_SCOPE(outer);
+	inner(n);
+	if (n > 1000)
+		return 1;        // early return still closes the scope
+	inner(n);
+	return 0;
+}
+
+/*
+ * Reads back one probe from a probe_dump() table
+ */
+static bool find_probe(const uint8_t *buf, size_t len, const char *name,
+		uint32_t *count, uint32_t *min, uint32_t *max, uint64_t *total) {
+	size_t off = 10;
+	uint16_t n = buf[8] | buf[9] << 8;
+
+	while (n-- && off < len) {
+		uint8_t name_len = buf[off];
+		const uint8_t *f = buf + off + 1 + name_len;
+
+		if (name_len == strlen(name) && !memcmp(buf + off + 1, name, name_len)) {
+			*count = f[0] | f[1] << 8 | f[2] << 16 | (uint32_t) f[3] << 24;
+			*min = f[4] | f[5] << 8 | f[6] << 16 | (uint32_t) f[7] << 24;
+			*max = f[8] | f[9] << 8 | f[10] << 16 | (uint32_t) f[11] << 24;
+			*total = 0;
+			for (int i = 7; i >= 0; i--)
+				*total = *total << 8 | f[12 + i];
+			return true;
+		}
+		off += 1 + name_len + 20;
+	}
+	return false;
+}
+
+int main(int argc, char **argv) {
+	uint8_t buf[512];
+	uint32_t count, min, max, ocount, omin, omax;
+	uint64_t total, ototal;
+	int test = 0, tests_passed = 0;
+	size_t len;
+	bool ok;
+
+	init_ticktime();
+
+	// Nothing is recorded while probes are off
+	outer(10);
+	probes_enable(true);
+	outer(10);         // inner twice
+	outer(100000);     // inner once, then the early return
+	probes_enable(false);
+	outer(10);
+
+	len = probe_dump(buf, sizeof(buf));
+	ok = len > 0 && find_probe(buf, len, "inner", &count, &min, &max, &total)
+			&& find_probe(buf, len, "outer", &ocount, &omin, &omax, &ototal);
+	ok = ok && count == 3 && ocount == 2;
+	printf("probe test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// Inclusive time: outer covers its inners, and min <= avg <= max
+	ok = ok && min <= max && (uint64_t) min * count <= total
+			&& total <= (uint64_t) max * count && ototal >= total
+			&& omax >= max;
+	printf("probe test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	// The table must not be written past the buffer
+	ok = probe_dump(buf, len - 1) == 0;
+	printf("probe test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	probes_reset();
+	len = probe_dump(buf, sizeof(buf));
+	ok = find_probe(buf, len, "inner", &count, &min, &max, &total) && count == 0
+			&& total == 0;
+	printf("probe test %d: %s\r\n", test, ok ? "success" : "FAILURE");
+	tests_passed += ok;
+	test++;
+
+	if (argc > 1) {
+		FILE *f = fopen(argv[1], "wb");
+		probes_enable(true);
+		outer(10);
+		len = probe_dump(buf, sizeof(buf));
+		if (!f || fwrite(buf, 1, len, f) != len) {
+			perror(argv[1]);
+			return 1;
+		}
+		fclose(f);
+	}
+
+	if (test != tests_passed) {
+		printf("TEST FAILURES EXIST\r\n");
+		return 1;
+	}
+	printf("All tests passed!\r\n");
+	return 0;
+}
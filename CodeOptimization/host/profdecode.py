@@ -0,0 +1,471 @@
+#!/usr/bin/env python3
+"""
+profdecode.py
+
+Offline decoder for the kinds of profile the firmware can record:
+
+  PC samples  pc_trace from pc_profiler.c, one (PC, LR) pair per SysTick.
+              Dump it from the debugger with
+                  dump binary value pcsamples.bin pc_trace
+  MTB trace   The Micro Trace Buffer set up by mtb.c, one (source,
+              destination) packet per taken branch. Dump the buffer and
+              note the MTB POSITION register (0xF0000000):
+                  dump binary memory mtb.bin __start_MTB __start_MTB+SIZE
+                  x/wx 0xF0000000
+  Probes      The PROBE_SCOPE registry from probe.c, as written by
+              probe_dump(), or the "PROBES <hex>" console line printed by
+              print_probe_dump(). Needs no symbols.
+  Call trace  The func_trace ring from func_trace.c, one (function,
+              timestamp) event per entry and exit, in a build with
+              -finstrument-functions. Dump it from the debugger with
+                  dump binary value ftrace.bin func_trace
+              or capture the "FTRACE <hex>" line of print_func_trace_dump().
+
+Addresses are resolved against the ELF symbol table and line table,
+read with <prefix>nm and <prefix>objdump. The output of those two tools
+can instead be given as files, so that recorded dumps decode with no
+board and no ARM toolchain:
+
+    arm-none-eabi-nm -n -S --defined-only PBKDF1.axf > PBKDF1.nm
+    arm-none-eabi-objdump --dwarf=decodedline PBKDF1.axf > PBKDF1.lines
+
+Reports (--report), all on stdout:
+
+  functions  hits per function, hottest first
+  lines      hits per source line, hottest first
+  folded     one "outer;...;inner count" line per stack, for flame graph
+             tools such as flamegraph.pl or speedscope
+  calls      call trace only: every call, indented by depth, with its
+             start time and duration
+
+For a call trace, functions gives calls, inclusive and exclusive time
+and min/max duration per function, and folded weighs each stack by its
+exclusive time in cycles. Calls that were already running when the
+trace started, or still running when it ended, are marked '~' and
+timed from the first or to the last event.
+
+A hit is one sample for a PC dump, and one executed halfword (about one
+Thumb instruction) for an MTB trace. PC sample stacks are two frames at
+most, the caller being taken from the stacked LR; MTB stacks are rebuilt
+by treating a branch to the first address of a function as a call and a
+branch back into a function already on the stack as a return.
+
+Usage:
+  profdecode.py (--elf ELF [--tool-prefix P] | --nm FILE --lines FILE)
+                (--pc DUMP | --mtb DUMP --mtb-position VALUE | --ftrace DUMP)
+                [--report functions|lines|folded|calls]
+  profdecode.py --probes DUMP
+"""
+
+import argparse
+import bisect
+import re
+import struct
+import subprocess
+import sys
+from collections import Counter
+
+PC_TRACE_MAGIC = 0x31534350      # "PCS1", see pc_profiler.h
+PROBE_DUMP_MAGIC = 0x31425250    # "PRB1", see probe.h
+FUNC_TRACE_MAGIC = 0x31525446    # "FTR1", see func_trace.h
+FUNC_TRACE_EXIT = 0x1
+FUNC_TRACE_WRAP = 0x1
+MTB_POSITION_WRAP = 0x4
+MTB_POSITION_POINTER = ~0x7 & 0xFFFFFFFF
+EXC_RETURN_MIN = 0xFFFFFFF0
+
+UNKNOWN = '(unknown)'
+
+
+class Symbols:
+    """Function address ranges from nm -n -S output."""
+
+    def __init__(self, text):
+        entries = []
+        for line in text.splitlines():
+            f = line.split()
+            if len(f) == 4 and f[2] in 'TtWw':
+                addr, size, name = int(f[0], 16) & ~1, int(f[1], 16), f[3]
+            elif len(f) == 3 and f[1] in 'TtWw':
+                addr, size, name = int(f[0], 16) & ~1, 0, f[2]
+            else:
+                continue
+            entries.append((addr, size, name))
+        entries.sort()
+
+        # Symbols without a size run up to the next one
+        self.starts, self.ends, self.names = [], [], []
+        for i, (addr, size, name) in enumerate(entries):
+            if self.starts and self.starts[-1] == addr:
+                continue
+            if size == 0:
+                size = entries[i + 1][0] - addr if i + 1 < len(entries) else 2
+            self.starts.append(addr)
+            self.ends.append(addr + size)
+            self.names.append(name)
+
+    def find(self, pc):
+        """Returns (name, start) of the function containing pc, or (None, None)."""
+        i = bisect.bisect_right(self.starts, pc) - 1
+        if i >= 0 and pc < self.ends[i]:
+            return self.names[i], self.starts[i]
+        return None, None
+
+    def name(self, pc):
+        return self.find(pc)[0] or UNKNOWN
+
+
+class Lines:
+    """Address to file:line from objdump --dwarf=decodedline output."""
+
+    ROW = re.compile(r'^(\S+)\s+(\d+|-)\s+(0x[0-9a-fA-F]+|\d+)(\s|$)')
+
+    def __init__(self, text):
+        rows = {}
+        for line in text.splitlines():
+            m = self.ROW.match(line)
+            if not m:
+                continue
+            addr = int(m.group(3), 0)
+            loc = None if m.group(2) == '-' else '%s:%s' % (m.group(1), m.group(2))
+            # The last row for an address is the one that applies
+            rows[addr] = loc
+        self.addrs = sorted(rows)
+        self.locs = [rows[a] for a in self.addrs]
+
+    def find(self, pc):
+        i = bisect.bisect_right(self.addrs, pc) - 1
+        if i >= 0 and self.locs[i] is not None:
+            return self.locs[i]
+        return UNKNOWN
+
+
+def run_tool(args):
+    try:
+        return subprocess.run(args, check=True, capture_output=True,
+                              text=True).stdout
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('%s: %s' % (args[0], e))
+
+
+def read_pc_dump(data):
+    """Returns the (pc, lr) samples of a pc_trace dump, oldest first."""
+    if len(data) < 12:
+        sys.exit('PC dump too short')
+    magic, count, capacity = struct.unpack_from('<III', data)
+    if magic != PC_TRACE_MAGIC:
+        sys.exit('PC dump has bad magic 0x%08X' % magic)
+    if len(data) < 12 + 8 * capacity:
+        sys.exit('PC dump truncated: %d samples expected' % capacity)
+
+    ring = [struct.unpack_from('<II', data, 12 + 8 * i) for i in range(capacity)]
+    if count <= capacity:
+        return ring[:count]
+    first = count % capacity
+    return ring[first:] + ring[:first]
+
+
+def read_mtb_dump(data, position):
+    """Returns the (source, destination, start) packets of an MTB dump, oldest first."""
+    pointer = (position & MTB_POSITION_POINTER) % max(len(data), 1)
+    packets = [struct.unpack_from('<II', data, off)
+               for off in range(0, len(data) - 7, 8)]
+    if position & MTB_POSITION_WRAP:
+        packets = packets[pointer // 8:] + packets[:pointer // 8]
+    else:
+        packets = packets[:pointer // 8]
+    return [(src & ~1, dst & ~1, bool(dst & 1)) for src, dst in packets]
+
+
+def profile_pc(samples, syms, lines):
+    funcs, locs, stacks = Counter(), Counter(), Counter()
+    for pc, lr in samples:
+        pc &= ~1
+        name = syms.name(pc)
+        funcs[name] += 1
+        locs[(lines.find(pc), name)] += 1
+
+        caller = None
+        if lr < EXC_RETURN_MIN:
+            caller = syms.find((lr & ~1) - 2)[0]
+        if caller and caller != name:
+            stacks['%s;%s' % (caller, name)] += 1
+        else:
+            stacks[name] += 1
+    return funcs, locs, stacks
+
+
+def profile_mtb(packets, syms, lines):
+    funcs, locs, stacks = Counter(), Counter(), Counter()
+    stack = []
+    for i, (src, dst, start) in enumerate(packets):
+        name, entry = syms.find(dst)
+        name = name or UNKNOWN
+
+        if start or not stack:
+            stack = [name]
+        elif dst == entry:
+            stack.append(name)                  # call, or exception entry
+        elif name in stack:
+            top = len(stack) - 1 - stack[::-1].index(name)
+            del stack[top + 1:]                 # return
+        else:
+            stack[-1] = name                    # jump into another function
+
+        # Everything from this destination up to the next branch ran in order
+        if i + 1 < len(packets) and not packets[i + 1][2]:
+            end = packets[i + 1][0]
+            if dst <= end < dst + 0x10000:
+                hits = (end - dst) // 2 + 1
+                for addr in range(dst, end + 1, 2):
+                    n = syms.name(addr)
+                    funcs[n] += 1
+                    locs[(lines.find(addr), n)] += 1
+                stacks[';'.join(stack)] += hits
+    return funcs, locs, stacks
+
+
+def read_probe_dump(data):
+    """Returns (cycles per second, [(name, count, min, max, total)])."""
+    text = data.lstrip()
+    if text.startswith(b'PROBES'):
+        data = bytes.fromhex(text.split()[1].decode())
+    if len(data) < 10:
+        sys.exit('probe dump too short')
+    magic, hz, n = struct.unpack_from('<IIH', data)
+    if magic != PROBE_DUMP_MAGIC:
+        sys.exit('probe dump has bad magic 0x%08X' % magic)
+
+    probes, off = [], 10
+    for _ in range(n):
+        name_len = data[off]
+        name = data[off + 1:off + 1 + name_len].decode()
+        off += 1 + name_len
+        count, lo, hi, total = struct.unpack_from('<IIIQ', data, off)
+        off += 20
+        probes.append((name, count, lo, hi, total))
+    return hz, probes
+
+
+def print_probes(hz, probes):
+    us = 1e6 / hz
+    print('# %d probes, %d cycles/sec, times in usec' % (len(probes), hz))
+    print('    calls       total         avg         min         max  probe')
+    for name, count, lo, hi, total in sorted(probes, key=lambda p: (-p[4], p[0])):
+        if count == 0:
+            print('%9d %11s %11s %11s %11s  %s' % (0, '-', '-', '-', '-', name))
+            continue
+        print('%9d %11.3f %11.3f %11.3f %11.3f  %s'
+              % (count, total * us, total * us / count, lo * us, hi * us, name))
+
+
+def read_ftrace_dump(data):
+    """Returns (cycles per second, [(addr, is_exit, timestamp)] oldest first, events lost)."""
+    text = data.lstrip()
+    if text.startswith(b'FTRACE'):
+        data = bytes.fromhex(text.split()[1].decode())
+    if len(data) < 20:
+        sys.exit('call trace dump too short')
+    magic, count, capacity, hz, flags = struct.unpack_from('<IIIII', data)
+    if magic != FUNC_TRACE_MAGIC:
+        sys.exit('call trace dump has bad magic 0x%08X' % magic)
+
+    stored = min(count, capacity)
+    if len(data) < 20 + 8 * stored:
+        sys.exit('call trace dump truncated: %d events expected' % stored)
+    ring = [struct.unpack_from('<II', data, 20 + 8 * i) for i in range(stored)]
+    lost = count - stored
+    if lost and flags & FUNC_TRACE_WRAP:
+        first = count % capacity
+        ring = ring[first:] + ring[:first]
+
+    events = [(a & ~FUNC_TRACE_EXIT, bool(a & FUNC_TRACE_EXIT), ts) for a, ts in ring]
+    return hz, events, lost
+
+
+class Call:
+    def __init__(self, name, start, partial=False):
+        self.name, self.start, self.end = name, start, None
+        self.partial, self.children = partial, []
+
+    def inclusive(self):
+        return self.end - self.start
+
+    def exclusive(self):
+        return self.inclusive() - sum(c.inclusive() for c in self.children)
+
+
+def build_calls(events, syms):
+    """Returns the top-level Calls of a trace, each holding its callees."""
+    roots, stack = [], []
+    if not events:
+        return roots
+
+    # 32-bit timestamps wrap; unwrap them relative to the first event
+    t, last_ts = 0, events[0][2]
+
+    for addr, is_exit, ts in events:
+        t += (ts - last_ts) & 0xFFFFFFFF
+        last_ts = ts
+        name = syms.name(addr)
+
+        if not is_exit:
+            call = Call(name, t)
+            (stack[-1].children if stack else roots).append(call)
+            stack.append(call)
+            continue
+
+        names = [c.name for c in stack]
+        if name in names:
+            # Anything above the returning function lost its exit event
+            while stack[-1].name != name:
+                stack[-1].end, stack[-1].partial = t, True
+                stack.pop()
+            stack.pop().end = t
+            continue
+
+        # Return from a call made before the trace started: it is the
+        # caller of everything recorded so far
+        for c in stack:
+            c.end, c.partial = t, True
+        stack = []
+        call = Call(name, 0, partial=True)
+        call.end, call.children = t, roots
+        roots = [call]
+
+    for c in stack:
+        c.end, c.partial = t, True
+    return roots
+
+
+def walk_calls(calls, depth=0, path=()):
+    for c in calls:
+        yield c, depth, path + (c.name,)
+        yield from walk_calls(c.children, depth + 1, path + (c.name,))
+
+
+def print_calls(hz, calls, events, lost):
+    us = 1e6 / hz
+    n = sum(1 for _ in walk_calls(calls))
+    print('# %d events, %d lost, %d calls, %d cycles/sec, times in usec'
+          % (len(events), lost, n, hz))
+    print('      start     duration  call')
+    for c, depth, _ in walk_calls(calls):
+        print('%11.3f %12.3f %s %s%s'
+              % (c.start * us, c.inclusive() * us, '~' if c.partial else ' ',
+                 '  ' * depth, c.name))
+
+
+def print_call_functions(hz, calls, events, lost):
+    us = 1e6 / hz
+    stats = {}
+    for c, _, path in walk_calls(calls):
+        s = stats.setdefault(c.name, [0, 0, 0, None, 0])
+        s[0] += 1
+        # Time in a recursive call is already in its outermost frame
+        if c.name not in path[:-1]:
+            s[1] += c.inclusive()
+        s[2] += c.exclusive()
+        s[3] = c.inclusive() if s[3] is None else min(s[3], c.inclusive())
+        s[4] = max(s[4], c.inclusive())
+
+    print('# %d events, %d lost, %d cycles/sec, times in usec'
+          % (len(events), lost, hz))
+    print('    calls   inclusive   exclusive         min         max  function')
+    for name, (n, inc, exc, lo, hi) in sorted(stats.items(),
+                                               key=lambda kv: (-kv[1][2], kv[0])):
+        print('%9d %11.3f %11.3f %11.3f %11.3f  %s'
+              % (n, inc * us, exc * us, lo * us, hi * us, name))
+
+
+def print_counts(counts, label, heading, fmt_key):
+    total = sum(counts.values()) or 1
+    print('# %d %s' % (sum(counts.values()), label))
+    print(heading)
+    for key, n in sorted(counts.items(), key=lambda kv: (-kv[1], kv[0])):
+        print('%9d  %6.2f%%  %s' % (n, 100.0 * n / total, fmt_key(key)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Decode profile and trace dumps')
+    src = ap.add_mutually_exclusive_group()
+    src.add_argument('--elf', help='firmware image (.axf/.elf)')
+    src.add_argument('--nm', help='recorded output of nm -n -S --defined-only')
+    ap.add_argument('--lines', help='recorded output of objdump --dwarf=decodedline')
+    ap.add_argument('--tool-prefix', default='arm-none-eabi-',
+                    help='binutils prefix used with --elf (default arm-none-eabi-)')
+    dump = ap.add_mutually_exclusive_group(required=True)
+    dump.add_argument('--probes', help='probe_dump() table or PROBES console line')
+    dump.add_argument('--pc', help='binary dump of pc_trace')
+    dump.add_argument('--mtb', help='binary dump of the MTB buffer')
+    dump.add_argument('--ftrace', help='func_trace dump or FTRACE console line')
+    ap.add_argument('--mtb-position', type=lambda s: int(s, 0),
+                    help='MTB POSITION register value at the time of the dump')
+    ap.add_argument('--report', choices=('functions', 'lines', 'folded', 'calls'),
+                    default='functions')
+    args = ap.parse_args()
+
+    if args.probes:
+        with open(args.probes, 'rb') as f:
+            print_probes(*read_probe_dump(f.read()))
+        return
+
+    if not args.elf and not args.nm:
+        ap.error('--pc, --mtb and --ftrace need --elf or --nm')
+    if args.elf:
+        syms = Symbols(run_tool([args.tool_prefix + 'nm', '-n', '-S',
+                                 '--defined-only', args.elf]))
+        lines = Lines(run_tool([args.tool_prefix + 'objdump',
+                                '--dwarf=decodedline', args.elf]))
+    else:
+        if not args.lines:
+            ap.error('--nm needs --lines')
+        with open(args.nm) as f:
+            syms = Symbols(f.read())
+        with open(args.lines) as f:
+            lines = Lines(f.read())
+
+    if args.ftrace:
+        with open(args.ftrace, 'rb') as f:
+            hz, events, lost = read_ftrace_dump(f.read())
+        calls = build_calls(events, syms)
+        if args.report == 'calls':
+            print_calls(hz, calls, events, lost)
+        elif args.report == 'functions':
+            print_call_functions(hz, calls, events, lost)
+        elif args.report == 'folded':
+            stacks = Counter()
+            for c, _, path in walk_calls(calls):
+                stacks[';'.join(path)] += c.exclusive()
+            for stack, n in sorted(stacks.items()):
+                print('%s %d' % (stack, n))
+        else:
+            ap.error('--ftrace has no line report')
+        return
+    if args.report == 'calls':
+        ap.error('--report calls needs --ftrace')
+
+    if args.pc:
+        with open(args.pc, 'rb') as f:
+            funcs, locs, stacks = profile_pc(read_pc_dump(f.read()), syms, lines)
+        label = 'samples'
+    else:
+        if args.mtb_position is None:
+            ap.error('--mtb needs --mtb-position')
+        with open(args.mtb, 'rb') as f:
+            packets = read_mtb_dump(f.read(), args.mtb_position)
+        funcs, locs, stacks = profile_mtb(packets, syms, lines)
+        label = 'instructions'
+
+    if args.report == 'functions':
+        print_counts(funcs, label, '     hits  percent  function', lambda k: k)
+    elif args.report == 'lines':
+        print_counts(locs, label, '     hits  percent  line  function',
+                     lambda k: '%s  %s' % k)
+    else:
+        for stack, n in sorted(stacks.items()):
+            print('%s %d' % (stack, n))
+
+
+if __name__ == '__main__':
+    main()
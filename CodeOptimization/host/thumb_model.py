@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+"""
+thumb_model.py
+
+Instruction-level model of the Thumb-1 kernel in ISHACompressBlock.S,
+for checking it without an ARM toolchain. The assembly source is read
+as written: macros are expanded, .if blocks are kept or dropped, and
+the few instructions the kernel uses are executed on a model of the
+low and high registers, the stack and memory. Both entry points are
+run on random inputs against a Python ISHA compression, and each is
+checked to restore the callee-saved registers and the stack pointer.
+The cycle count per call is printed, with the Cortex-M0+ timings (LDR,
+STR 2; LDM, PUSH, POP 1 + registers, +2 for a POP of pc; the rest 1).
+
+This does not replace make check-arm, which runs the assembled kernel
+under qemu-arm; it checks the instruction sequence, not the encoding.
+
+Usage:
+  thumb_model.py [--blocks N] [--source PATH]
+"""
+
+import argparse
+import random
+import re
+import struct
+import sys
+
+MASK = 0xFFFFFFFF
+ISHA_IV = [0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0]
+ENTRIES = {"ISHACompressBlockAsm": True, "ISHACompressWordsAsm": False}
+
+
+def strip(line):
+    """Returns line without its comment and surrounding space."""
+    return line.split("//")[0].strip()
+
+
+def read_macros(lines):
+    """Returns {name: (params, defaults, body lines)} for every .macro."""
+    macros = {}
+    i = 0
+    while i < len(lines):
+        line = strip(lines[i])
+        if line.startswith(".macro"):
+            head = line[len(".macro"):].strip().split(None, 1)
+            params, defaults = [], {}
+            for p in (head[1].split(",") if len(head) > 1 else []):
+                name, _, default = p.strip().partition("=")
+                params.append(name)
+                if default:
+                    defaults[name] = default
+            body = []
+            i += 1
+            while strip(lines[i]) != ".endm":
+                body.append(lines[i])
+                i += 1
+            macros[head[0]] = (params, defaults, body)
+        i += 1
+    return macros
+
+
+def expand(lines, macros):
+    """Expands macro calls and resolves .if/.endif, recursively."""
+    out = []
+    keep = [True]
+    for raw in lines:
+        line = strip(raw)
+        if not line:
+            continue
+        if line.startswith(".if"):
+            keep.append(keep[-1] and int(line[3:].strip(), 0) != 0)
+            continue
+        if line == ".endif":
+            keep.pop()
+            continue
+        if not keep[-1]:
+            continue
+        word = line.split(None, 1)
+        if word[0] in macros:
+            params, defaults, body = macros[word[0]]
+            args = [a.strip() for a in word[1].split(",")] if len(word) > 1 else []
+            values = dict(defaults)
+            values.update(zip(params, args))
+            # Longest names first, so \swap is not replaced as \s
+            for name in sorted(values, key=len, reverse=True):
+                body = [b.replace("\\" + name, values[name]) for b in body]
+            out += expand(body, macros)
+        else:
+            out.append(line)
+    return out
+
+
+def entry_code(path, entry):
+    """Returns the expanded instructions from label entry to its .size."""
+    lines = open(path).read().splitlines()
+    macros = read_macros(lines)
+    start = lines.index(entry + ":")
+    end = next(i for i in range(start, len(lines))
+               if strip(lines[i]).startswith(".size " + entry))
+    return [line for line in expand(lines[start + 1:end], macros)
+            if not line.startswith(".")]
+
+
+def ror(x, n):
+    n &= 31
+    return ((x >> n) | (x << (32 - n))) & MASK
+
+
+def rol(x, n):
+    return ror(x, 32 - n)
+
+
+def reg_list(text):
+    regs = []
+    for part in text.strip("{}").split(","):
+        part = part.strip()
+        if "-" in part:
+            a, b = part.split("-")
+            regs += ["r%d" % i for i in range(int(a[1:]), int(b[1:]) + 1)]
+        else:
+            regs.append(part)
+    return regs
+
+
+def run(code, md, words):
+    """
+    Runs code with r0 = MD and r1 = the 16 words in memory. Returns
+    (MD after, cycles). Raises AssertionError if a callee-saved register
+    or sp is not restored.
+    """
+    md_addr, w_addr, sp = 0x1000, 0x2000, 0x8000
+    mem = {}
+    for i, w in enumerate(md):
+        mem[md_addr + 4 * i] = w
+    for i, w in enumerate(words):
+        mem[w_addr + 4 * i] = w
+    r = {"r%d" % i: random.getrandbits(32) for i in range(13)}
+    r.update(r0=md_addr, r1=w_addr, sp=sp, lr=0xDEAD)
+    saved = {k: r[k] for k in ("r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11")}
+    cycles = 0
+
+    def value(x):
+        return int(x[1:], 0) if x.startswith("#") else r[x]
+
+    def address(x):
+        m = re.match(r"\[(\w+), #(\d+)\]", x)
+        return r[m.group(1)] + int(m.group(2))
+
+    for line in code:
+        op, rest = line.split(None, 1)
+        a = [x.strip() for x in re.split(r",(?![^{]*})(?![^\[]*\])", rest)]
+        if op == "PUSH":
+            regs = reg_list(a[0])
+            r["sp"] -= 4 * len(regs)
+            for i, reg in enumerate(regs):
+                mem[r["sp"] + 4 * i] = r[reg]
+            cycles += 1 + len(regs)
+        elif op == "POP":
+            regs = reg_list(a[0])
+            for i, reg in enumerate(regs):
+                r[reg] = mem[r["sp"] + 4 * i]
+            r["sp"] += 4 * len(regs)
+            cycles += 1 + len(regs) + (2 if "pc" in regs else 0)
+        elif op in ("MOV", "MOVS"):
+            r[a[0]] = value(a[1])
+            cycles += 1
+        elif op == "LDM":
+            base, regs = r[a[0]], reg_list(a[1])
+            for i, reg in enumerate(regs):
+                r[reg] = mem[base + 4 * i]
+            cycles += 1 + len(regs)
+        elif op == "LDR":
+            r[a[0]] = mem[address(a[1])]
+            cycles += 2
+        elif op == "STR":
+            mem[address(a[1])] = r[a[0]]
+            cycles += 2
+        elif op == "REV":
+            r[a[0]] = struct.unpack(">I", struct.pack("<I", r[a[1]]))[0]
+            cycles += 1
+        elif op == "ADDS":
+            r[a[0]] = (r[a[1]] + r[a[2]]) & MASK
+            cycles += 1
+        elif op == "EORS":
+            r[a[0]] = r[a[1]] ^ r[a[2]]
+            cycles += 1
+        elif op == "ANDS":
+            r[a[0]] = r[a[1]] & r[a[2]]
+            cycles += 1
+        elif op == "RORS":
+            r[a[0]] = ror(r[a[1]], r[a[2]] & 0xFF)
+            cycles += 1
+        else:
+            raise ValueError("instruction not modelled: " + line)
+
+    assert r["sp"] == sp, "sp not restored"
+    assert r["pc"] == 0xDEAD, "did not return to lr"
+    for k in saved:
+        assert r[k] == saved[k], k + " not restored"
+    return [mem[md_addr + 4 * i] for i in range(5)], cycles
+
+
+def compress(md, words):
+    """The ISHA compression of isha.c on big-endian message words."""
+    a, b, c, d, e = md
+    for w in words:
+        temp = (rol(a, 5) + ((b & c) | (~b & d & MASK)) + e + w) & MASK
+        e, d, c, b, a = rol(d, 25), rol(c, 15), rol(b, 30), rol(a, 10), rol(temp, 5)
+    return [(x + y) & MASK for x, y in zip(md, (a, b, c, d, e))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--blocks", type=int, default=2000)
+    parser.add_argument("--source", default="../source/ISHACompressBlock.S")
+    args = parser.parse_args()
+    random.seed(0x2545F491)
+
+    failures = 0
+    for test, (entry, swapped) in enumerate(sorted(ENTRIES.items())):
+        code = entry_code(args.source, entry)
+        ok = True
+        cycles = 0
+        inputs = [(ISHA_IV, list(range(16)))]
+        inputs += [([random.getrandbits(32) for _ in range(5)],
+                    [random.getrandbits(32) for _ in range(16)])
+                   for _ in range(args.blocks)]
+        for md, words in inputs:
+            # The byte entry point reads little-endian words of the
+            # big-endian message; the word entry point the words as-is
+            mem_words = [struct.unpack("<I", struct.pack(">I", w))[0]
+                         for w in words] if swapped else words
+            try:
+                out, cycles = run(code, md, mem_words)
+            except AssertionError as err:
+                print("%s: %s" % (entry, err))
+                ok = False
+                break
+            if out != compress(md, words):
+                print("%s: mismatch on md %s" % (entry, md))
+                ok = False
+                break
+        print("thumb_model test %d: %s (%s, %d cycles)" %
+              (test, "success" if ok else "FAILURE", entry, cycles))
+        failures += not ok
+
+    if failures:
+        print("TEST FAILURES EXIST")
+        return 1
+    print("All tests passed!")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
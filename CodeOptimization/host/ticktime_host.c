@@ -0,0 +1,50 @@
+/*
+ * ticktime_host.c
+ *
+ * Host implementation of ticktime.h on CLOCK_MONOTONIC, with the same
+ * tenth-of-an-msec units as the SysTick version in ../source/ticktime.c.
+ * ticktime_cycles() counts nanoseconds here.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "ticktime.h"
+
+static uint64_t g_start_us, g_timer_us;
+
+static uint64_t now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void init_ticktime(void) {
+	g_start_us = g_timer_us = now_us();
+}
+
+ticktime_t now(void) {
+	return (now_us() - g_start_us) / 100;
+}
+
+void reset_timer(void) {
+	g_timer_us = now_us();
+}
+
+ticktime_t get_timer(void) {
+	return (now_us() - g_timer_us) / 100;
+}
+
+uint32_t ticktime_cycles(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint32_t ticktime_us(void) {
+	return now_us() - g_start_us;
+}
+
+uint64_t ticktime_us64(void) {
+	return now_us() - g_start_us;
+}
@@ -0,0 +1,352 @@
+/*
+ * bench.c
+ *
+ * The benchmark registry and console command. See bench.h.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#include "fsl_debug_console.h"
+#include "bench.h"
+#include "fastdiv.h"
+#include "isha.h"
+#include "pbkdf1.h"
+#include "pbkdf1_test.h"
+#include "ticktime.h"
+
+#define BENCH_BUF_LEN  512      // bytes; bounds the cmp_bin and hexstr_to_bytes arg
+#define MAX_ARGS       4        // words in a command line
+
+static uint32_t g_md[5];
+static uint32_t g_block[ISHA_BLOCKLEN / 4];                // word aligned
+static uint8_t g_buf[2][BENCH_BUF_LEN];
+static char g_hex[2 * BENCH_BUF_LEN];
+static volatile uint32_t g_sink;                           // keeps results live
+
+static uint32_t clamp_len(uint32_t len) {
+	return len < BENCH_BUF_LEN ? len : BENCH_BUF_LEN;
+}
+
+static void run_isha_block(uint32_t blocks) {
+	while (blocks--) {
+		ISHACompressBlock(g_md, (const uint8_t *) g_block);
+	}
+	g_sink = g_md[0];
+}
+
+#if defined(__arm__)
+static void run_isha_block_asm(uint32_t blocks) {
+	while (blocks--) {
+		ISHACompressBlockAsm(g_md, (const uint8_t *) g_block);
+	}
+	g_sink = g_md[0];
+}
+#endif
+
+static void run_pbkdf1(uint32_t iterations) {
+	static const uint8_t pass[] = "Boulder", salt[] = "Buffaloes";
+
+	g_sink = pbkdf1(pass, sizeof(pass) - 1, salt, sizeof(salt) - 1,
+			iterations, g_buf[0], ISHA_DIGESTLEN);
+}
+
+static void run_cmp_bin(uint32_t len) {
+	// Equal buffers, the worst case: every byte is compared
+	g_sink = cmp_bin(g_buf[0], g_buf[1], clamp_len(len));
+}
+
+static void run_hexstr_to_bytes(uint32_t len) {
+	hexstr_to_bytes(g_buf[0], g_hex, clamp_len(len));
+	g_sink = g_buf[0][0];
+}
+
+/*
+ * Division pairs: the same loop dividing by the compiler (__aeabi_uidiv
+ * on the Cortex-M0+) and by reciprocal multiply, so the difference over
+ * arg divisions is the saving per call. The dividends change every pass
+ * so nothing is folded.
+ */
+static void run_udiv10_libgcc(uint32_t n) {
+	uint32_t acc = 0, x = g_block[0];
+
+	while (n--) {
+		acc += x / 10;
+		x += 0x9E3779B9u;
+	}
+	g_sink = acc;
+}
+
+static void run_udiv10_recip(uint32_t n) {
+	uint32_t acc = 0, x = g_block[0];
+
+	while (n--) {
+		acc += udiv10(x);
+		x += 0x9E3779B9u;
+	}
+	g_sink = acc;
+}
+
+static void run_rgb_scale_libgcc(uint32_t n) {
+	uint32_t acc = 0, x = g_block[0];
+
+	while (n--) {
+		acc += (x & 0xFF) * 1200 / 255;
+		x += 0x9E3779B9u;
+	}
+	g_sink = acc;
+}
+
+FASTDIV_CHECK(1200, 255, 16, 8);
+
+static void run_rgb_scale_recip(uint32_t n) {
+	uint32_t acc = 0, x = g_block[0];
+
+	while (n--) {
+		acc += UMULDIV_CONST(x & 0xFF, 1200, 255, 16);
+		x += 0x9E3779B9u;
+	}
+	g_sink = acc;
+}
+
+static const Bench g_benches[] = {
+	{ "isha_block", "blocks", 1, run_isha_block },
+#if defined(__arm__)
+	{ "isha_block_asm", "blocks", 1, run_isha_block_asm },
+#endif
+	{ "pbkdf1", "iterations", 4096, run_pbkdf1 },
+	{ "cmp_bin", "bytes", ISHA_DIGESTLEN, run_cmp_bin },
+	{ "hexstr_to_bytes", "bytes", ISHA_DIGESTLEN, run_hexstr_to_bytes },
+	{ "udiv10_libgcc", "divisions", 100, run_udiv10_libgcc },
+	{ "udiv10_recip", "divisions", 100, run_udiv10_recip },
+	{ "rgb_scale_libgcc", "divisions", 100, run_rgb_scale_libgcc },
+	{ "rgb_scale_recip", "divisions", 100, run_rgb_scale_recip },
+};
+
+#define BENCH_COUNT (sizeof(g_benches) / sizeof(g_benches[0]))
+
+size_t bench_count(void) {
+	return BENCH_COUNT;
+}
+
+const Bench *bench_get(size_t i) {
+	return i < BENCH_COUNT ? &g_benches[i] : NULL;
+}
+
+static bool str_eq(const char *a, const char *b) {
+	while (*a && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+const Bench *bench_find(const char *name) {
+	size_t i;
+
+	for (i = 0; i < BENCH_COUNT; i++) {
+		if (str_eq(g_benches[i].name, name)) {
+			return &g_benches[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Fills the inputs with a fixed pattern, so that every build measures
+ * the same work
+ */
+static void init_inputs(void) {
+	static const char digits[] = "0123456789abcdef";
+	size_t i;
+
+	for (i = 0; i < 5; i++) {
+		g_md[i] = 0x67452301u * (i + 1);
+	}
+	for (i = 0; i < ISHA_BLOCKLEN / 4; i++) {
+		g_block[i] = 0x9E3779B9u * (i + 1);
+	}
+	for (i = 0; i < BENCH_BUF_LEN; i++) {
+		uint8_t byte = (uint8_t) (i * 7);
+
+		g_buf[0][i] = g_buf[1][i] = byte;
+		g_hex[2 * i] = digits[byte >> 4];
+		g_hex[2 * i + 1] = digits[byte & 0xF];
+	}
+}
+
+/*
+ * The cost of the timing itself: the shortest of a few back-to-back
+ * ticktime_cycles() pairs
+ */
+static uint32_t timer_overhead(void) {
+	uint32_t best = UINT32_MAX, start, elapsed;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		start = ticktime_cycles();
+		elapsed = ticktime_cycles() - start;
+		if (elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return best;
+}
+
+bool bench_run(const Bench *bench, uint32_t arg, uint32_t reps,
+		BenchResult *result) {
+	uint32_t samples[BENCH_MAX_REPS];
+	uint32_t overhead, start, elapsed, i, j;
+
+	if (reps == 0) {
+		reps = BENCH_DEFAULT_REPS;
+	}
+	if (reps > BENCH_MAX_REPS) {
+		return false;
+	}
+	if (arg == 0) {
+		arg = bench->default_arg;
+	}
+
+	init_inputs();
+	overhead = timer_overhead();
+	for (i = 0; i < BENCH_WARMUP; i++) {
+		bench->run(arg);
+	}
+
+	// Time each repetition, keeping samples sorted as they come
+	for (i = 0; i < reps; i++) {
+		start = ticktime_cycles();
+		bench->run(arg);
+		elapsed = ticktime_cycles() - start;
+		elapsed = elapsed > overhead ? elapsed - overhead : 0;
+
+		for (j = i; j > 0 && samples[j - 1] > elapsed; j--) {
+			samples[j] = samples[j - 1];
+		}
+		samples[j] = elapsed;
+	}
+
+	result->bench = bench;
+	result->arg = arg;
+	result->reps = reps;
+	result->min = samples[0];
+	result->median = samples[reps / 2];
+	result->max = samples[reps - 1];
+	return true;
+}
+
+void print_bench_result(const BenchResult *result) {
+	const Bench *bench = result->bench;
+
+	PRINTF("%s(%u %s): median %u, min %u, max %u cycles over %u reps\r\n",
+			bench->name, result->arg, bench->arg_help, result->median,
+			result->min, result->max, result->reps);
+	PRINTF("BENCH,%s,%s,%u,%u,%u,%u,%u,%u\r\n", BENCH_BUILD, bench->name,
+			result->arg, result->reps, (uint32_t) TICKTIME_CYCLE_HZ,
+			result->min, result->median, result->max);
+}
+
+/*
+ * Splits line into words at spaces, in place in buf. Returns the
+ * number of words, or MAX_ARGS + 1 if there are too many.
+ */
+static int split_words(const char *line, char *buf, size_t len,
+		char *argv[MAX_ARGS]) {
+	int argc = 0;
+	size_t i = 0;
+
+	while (*line && i < len - 1) {
+		while (*line == ' ' || *line == '\t') {
+			line++;
+		}
+		if (!*line) {
+			break;
+		}
+		if (argc == MAX_ARGS) {
+			return MAX_ARGS + 1;
+		}
+		argv[argc++] = &buf[i];
+		while (*line && *line != ' ' && *line != '\t' && i < len - 1) {
+			buf[i++] = *line++;
+		}
+		buf[i++] = '\0';
+	}
+	return argc;
+}
+
+/*
+ * Parses a decimal number. Returns false if str is not one.
+ */
+static bool parse_u32(const char *str, uint32_t *out) {
+	uint32_t value = 0;
+
+	if (!*str) {
+		return false;
+	}
+	for (; *str; str++) {
+		if (*str < '0' || *str > '9' || value > (UINT32_MAX - 9) / 10) {
+			return false;
+		}
+		value = value * 10 + (*str - '0');
+	}
+	*out = value;
+	return true;
+}
+
+static void print_usage(void) {
+	PRINTF("usage: bench list | bench all [reps] | bench <name> [arg [reps]]\r\n");
+}
+
+bool bench_command(const char *line) {
+	char buf[64];
+	char *argv[MAX_ARGS];
+	const Bench *bench;
+	BenchResult result;
+	uint32_t arg = 0, reps = 0;
+	int argc = split_words(line, buf, sizeof(buf), argv);
+	size_t i;
+
+	if (argc < 2 || argc > MAX_ARGS || !str_eq(argv[0], "bench")) {
+		print_usage();
+		return false;
+	}
+
+	if (str_eq(argv[1], "list")) {
+		if (argc != 2) {
+			print_usage();
+			return false;
+		}
+		for (i = 0; i < BENCH_COUNT; i++) {
+			PRINTF("%s [%s, default %u]\r\n", g_benches[i].name,
+					g_benches[i].arg_help, g_benches[i].default_arg);
+		}
+		return true;
+	}
+
+	if (str_eq(argv[1], "all")) {
+		if (argc > 3 || (argc == 3 && !parse_u32(argv[2], &reps))
+				|| reps > BENCH_MAX_REPS) {
+			print_usage();
+			return false;
+		}
+		for (i = 0; i < BENCH_COUNT; i++) {
+			bench_run(&g_benches[i], 0, reps, &result);
+			print_bench_result(&result);
+		}
+		return true;
+	}
+
+	bench = bench_find(argv[1]);
+	if (!bench) {
+		PRINTF("no benchmark called %s; try bench list\r\n", argv[1]);
+		return false;
+	}
+	if ((argc >= 3 && !parse_u32(argv[2], &arg))
+			|| (argc == 4 && !parse_u32(argv[3], &reps))
+			|| !bench_run(bench, arg, reps, &result)) {
+		print_usage();
+		return false;
+	}
+	print_bench_result(&result);
+	return true;
+}
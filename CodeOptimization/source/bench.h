@@ -0,0 +1,95 @@
+/*
+ * bench.h
+ *
+ * Registry of named micro-benchmarks that can be run on demand from the
+ * debug console, so a measurement does not need a reflash. Each run
+ * does a few untimed warm-up repetitions, then times every repetition
+ * with ticktime_cycles() and reports the median, min and max in
+ * cycles. The median is the figure to track: a SysTick interrupt that
+ * lands inside a repetition only moves the max.
+ *
+ * Every result is printed twice: once for people, and once as a
+ * comma-separated line for the host,
+ *
+ *   BENCH,<build>,<name>,<arg>,<reps>,<cycles/sec>,<min>,<median>,<max>
+ *
+ * which host/benchcmp.py collects from console logs and compares
+ * between firmware builds. <build> is BENCH_BUILD, the compile date
+ * and time unless the build sets it (e.g. to the git revision).
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef BENCH_BUILD
+#define BENCH_BUILD __DATE__ " " __TIME__
+#endif
+
+#define BENCH_WARMUP       2   // untimed repetitions before each run
+#define BENCH_DEFAULT_REPS 11
+#define BENCH_MAX_REPS     64
+
+typedef struct {
+	const char *name;
+	const char *arg_help;          // what arg means
+	uint32_t default_arg;
+	void (*run)(uint32_t arg);     // one repetition
+} Bench;
+
+typedef struct {
+	const Bench *bench;
+	uint32_t arg, reps;
+	uint32_t min, median, max;     // cycles per repetition, timer overhead removed
+} BenchResult;
+
+/*
+ * Returns the number of registered benchmarks, and the i'th of them
+ */
+size_t bench_count(void);
+const Bench *bench_get(size_t i);
+
+/*
+ * Returns the benchmark called name, or NULL if there is none
+ */
+const Bench *bench_find(const char *name);
+
+/*
+ * Runs a benchmark.
+ *
+ * Parameters:
+ *   bench    The benchmark
+ *   arg      Its argument; 0 selects bench->default_arg
+ *   reps     Timed repetitions, 1 to BENCH_MAX_REPS; 0 selects
+ *            BENCH_DEFAULT_REPS
+ *   result   Output
+ *
+ * Returns:
+ *   false if reps is out of range
+ */
+bool bench_run(const Bench *bench, uint32_t arg, uint32_t reps,
+		BenchResult *result);
+
+/*
+ * Prints a result, as a readable line and as a BENCH line
+ */
+void print_bench_result(const BenchResult *result);
+
+/*
+ * Carries out one console command:
+ *
+ *   bench list                        the registered benchmarks
+ *   bench all [reps]                  every benchmark at its default arg
+ *   bench <name> [arg [reps]]         one benchmark
+ *
+ * Returns:
+ *   false, after printing the usage, if line is not a valid command
+ */
+bool bench_command(const char *line);
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ * ****************************************************************************/
+
+/**
+ * @file    cbfifo.c
+ * @brief   The cbfifo functions, on top of the cbfifo_ring generated by
+ *          RING_DEFINE in cbfifo.h, for the UART receive path.
+ *
+ * See ring.h for how the ring works; it is the one CommandProcessor
+ * uses.
+ *
+ * @author  Suhas Srinivasa Reddy
+ * @date    19th sept 2023
+ */
+#include "cbfifo.h"
+
+Buffer rx_buffer; // Static initialization of struct buffer
+
+/**
+ * @brief      { This function enqueue nbytes of data into the circular buffer from the source.}
+ *
+ * @param[in]  buf        Input data to the buffer
+ * @param[in]  nbyte      Size of the buffer
+ *
+ * @return     { Returns number of bytes enqueued or 0 if no byte is added.}
+ */
+size_t cbfifo_enqueue(Buffer *buffer, void *buf, size_t nbyte) {
+	return cbfifo_ring_enqueue(buffer, (const char*) buf, nbyte);
+}
+
+/**
+ * @brief      { This function dequeue nbytes of data from the circular buffer to the desination.}
+ *
+ * @param[in]  buf        Output data from the buffer
+ * @param[in]  nbyte      Size of the requested output data
+ *
+ * @return     { Returns number of bytes dequeued 0 if no byte is removed.}
+ */
+size_t cbfifo_dequeue(Buffer *buffer, void *buf, size_t nbyte) {
+	return cbfifo_ring_dequeue(buffer, (char*) buf, nbyte);
+}
+
+/**
+ * @brief      { This function gives the consumer the oldest bytes in place.}
+ *
+ * @param[out] data       Set to the oldest byte in the buffer
+ *
+ * @return     { Returns the number of bytes readable at data without a wrap.}
+ */
+size_t cbfifo_peek_contiguous(Buffer *buffer, char **data) {
+	return cbfifo_ring_peek_contiguous(buffer, data);
+}
+
+/**
+ * @brief      { This function releases bytes the consumer has read in place.}
+ *
+ * @param[in]  nbyte      Bytes to release, at most what cbfifo_peek_contiguous() returned
+ */
+void cbfifo_commit(Buffer *buffer, size_t nbyte) {
+	cbfifo_ring_commit(buffer, nbyte);
+}
+
+/**
+ * @brief      { This function returns number of elements in the buffer.}
+ *
+ * @return     { Returns number of elements in the buffer.}
+ */
+size_t cbfifo_length(Buffer *buffer) {
+	return cbfifo_ring_length(buffer);
+}
+
+/**
+ * @brief      { This function returns the total capacity of the buffer.}
+ *
+ * @return     { Returns the total capacity of the buffer.}
+ */
+size_t cbfifo_capacity() {
+	return cbfifo_ring_capacity();
+}
+
+/**
+ * @brief      { This function resets the buffer.}
+ */
+void cbfifo_reset(Buffer *buffer) {
+	cbfifo_ring_reset(buffer);
+}
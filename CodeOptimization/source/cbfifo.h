@@ -0,0 +1,103 @@
+/*
+ * cbfifo.h - a fixed-size FIFO implemented via a circular buffer
+ *
+ * Author: Howdy Pierce/Lalit Pandit
+ *
+ * The cbfifo of CommandProcessor/source/cbfifo.h, on the same ring.h,
+ * brought over for the UART receive path of this project. It is larger
+ * here, so that a burst of input can wait while the main loop is busy,
+ * and only the receive ring is used.
+ */
+
+#ifndef _CBFIFO_H_
+#define _CBFIFO_H_
+
+#include <stdint.h>
+#include <stddef.h>  // for size_t
+#include "ring.h"
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 512  // eight ISHA blocks, 44 msec of input at 115200 baud
+#endif
+#define ZERO 0
+
+/*
+ * The byte ring of ring.h, under the cbfifo names. Single producer, the
+ * UART interrupt, and single consumer, the main loop: only the producer
+ * writes tail and only the consumer writes head, so neither masks
+ * interrupts. BUFFER_SIZE is a multiple of the 64-byte ISHA block, so a
+ * block that starts on a block boundary of the storage never wraps.
+ */
+RING_DEFINE(cbfifo_ring, char, BUFFER_SIZE)
+
+typedef cbfifo_ring Buffer;
+
+extern Buffer rx_buffer;
+
+/*
+ * Enqueues data onto the FIFO, up to the limit of the available FIFO
+ * capacity.
+ *
+ * Parameters:
+ *   buffer   The FIFO
+ *   buf      Pointer to the data
+ *   nbyte    Max number of bytes to enqueue
+ *
+ * Returns:
+ *   The number of bytes actually enqueued, which could be 0.
+ */
+size_t cbfifo_enqueue(Buffer *buffer, void *buf, size_t nbyte);
+
+/*
+ * Attempts to remove ("dequeue") up to nbyte bytes of data from the
+ * FIFO. Removed data will be copied into the buffer pointed to by buf.
+ *
+ * Parameters:
+ *   buffer   The FIFO
+ *   buf      Destination for the dequeued data
+ *   nbyte    Bytes of data requested
+ *
+ * Returns:
+ *   The number of bytes actually copied, which will be between 0 and
+ *   nbyte(inclusive of both).
+ */
+size_t cbfifo_dequeue(Buffer *buffer, void *buf, size_t nbyte);
+
+/*
+ * Zero-copy access for the consumer: points *data at the oldest byte
+ * and returns how many bytes can be read there before the end of the
+ * storage. Read them in place, then release them with cbfifo_commit().
+ *
+ * Parameters:
+ *   buffer   The FIFO
+ *   data     Set to the oldest byte
+ *
+ * Returns:
+ *   Bytes readable at *data, 0 if the FIFO is empty
+ */
+size_t cbfifo_peek_contiguous(Buffer *buffer, char **data);
+
+/*
+ * Releases nbyte bytes read in place after cbfifo_peek_contiguous().
+ * nbyte must not exceed what cbfifo_peek_contiguous() returned.
+ */
+void cbfifo_commit(Buffer *buffer, size_t nbyte);
+
+/*
+ * Returns the number of bytes currently on the FIFO.
+ */
+size_t cbfifo_length(Buffer *buffer);
+
+/*
+ * Returns the FIFO's capacity, in bytes
+ */
+size_t cbfifo_capacity();
+
+/*
+ * Resets the FIFO clearing all elements resulting in a 0 length. This
+ * discards from the consumer side, so it is safe while the producer is
+ * running.
+ */
+void cbfifo_reset(Buffer *buffer);
+
+#endif // _CBFIFO_H_
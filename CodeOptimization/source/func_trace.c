@@ -0,0 +1,133 @@
+/*
+ * func_trace.c
+ *
+ * -finstrument-functions hooks and the event ring behind them. See
+ * func_trace.h.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#include "fsl_debug_console.h"
+#include "func_trace.h"
+#include "ticktime.h"
+
+#ifdef FUNC_TRACE
+
+#if (FUNC_TRACE_LEN & (FUNC_TRACE_LEN - 1)) != 0
+#error "FUNC_TRACE_LEN must be a power of two"
+#endif
+
+FuncTrace func_trace = {
+	.magic = FUNC_TRACE_MAGIC,
+	.count = 0,
+	.capacity = FUNC_TRACE_LEN,
+	.cycle_hz = TICKTIME_CYCLE_HZ,
+	.flags = 0,
+};
+
+static volatile bool func_trace_on;
+
+/*
+ * Reserves the next slot of the ring, timestamps it, and returns its
+ * sequence number. An interrupt that arrives between two hooks records
+ * into its own slot, so events from handlers nest properly inside the
+ * thread's.
+ *
+ * The Cortex-M0+ has no LDREX/STREX, so the claim is made atomic by
+ * masking interrupts around it, restoring PRIMASK afterwards so that
+ * the hooks are safe with interrupts already masked. The timestamp is
+ * taken inside, so timestamps follow slot order; ticktime_cycles() is
+ * exact with interrupts masked. Inline asm rather than the CMSIS
+ * intrinsics, which would be instrumented themselves when inlined here.
+ */
+static inline uint32_t FUNC_TRACE_NO_INSTRUMENT claim_slot(uint32_t *ts) {
+	uint32_t seq;
+#ifdef __arm__
+	uint32_t primask;
+
+	__asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+	*ts = ticktime_cycles();
+	seq = func_trace.count;
+	func_trace.count = seq + 1;
+	__asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+#else
+	*ts = ticktime_cycles();
+	seq = __atomic_fetch_add(&func_trace.count, 1, __ATOMIC_RELAXED);
+#endif
+	return seq;
+}
+
+/*
+ * Records one event.
+ */
+static inline void FUNC_TRACE_NO_INSTRUMENT record(void *fn, uint32_t exit) {
+	uint32_t ts, seq;
+
+	if (!func_trace_on) {
+		return;
+	}
+
+	seq = claim_slot(&ts);
+	if (seq >= FUNC_TRACE_LEN && !(func_trace.flags & FUNC_TRACE_WRAP)) {
+		return;     // full; count still tells the decoder how many were lost
+	}
+
+	seq &= FUNC_TRACE_LEN - 1;
+	func_trace.event[seq][0] = ((uint32_t) (uintptr_t) fn & ~FUNC_TRACE_EXIT) | exit;
+	func_trace.event[seq][1] = ts;
+}
+
+void __cyg_profile_func_enter(void *this_fn, void *call_site) {
+	(void) call_site;
+	record(this_fn, 0);
+}
+
+void __cyg_profile_func_exit(void *this_fn, void *call_site) {
+	(void) call_site;
+	record(this_fn, FUNC_TRACE_EXIT);
+}
+
+void func_trace_enable(bool on) {
+	func_trace_on = on;
+}
+
+void func_trace_reset(bool wrap) {
+	func_trace.flags = wrap ? FUNC_TRACE_WRAP : 0;
+	func_trace.count = 0;
+}
+
+/*
+ * Prints the header and the events recorded, in memory order. An
+ * unwrapped ring is cut after the last event, which the decoder allows.
+ */
+void print_func_trace_dump(void) {
+	const uint8_t *p = (const uint8_t *) &func_trace;
+	uint32_t events = func_trace.count;
+	size_t i, n;
+
+	if (events > FUNC_TRACE_LEN) {
+		events = FUNC_TRACE_LEN;
+	}
+	n = offsetof(FuncTrace, event) + events * sizeof(func_trace.event[0]);
+
+	PRINTF("FTRACE ");
+	for (i = 0; i < n; i++) {
+		PRINTF("%02x", p[i]);
+	}
+	PRINTF("\r\n");
+}
+
+#else
+
+void func_trace_enable(bool on) {
+	(void) on;
+}
+
+void func_trace_reset(bool wrap) {
+	(void) wrap;
+}
+
+void print_func_trace_dump(void) {
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * func_trace.h
+ *
+ * Function entry/exit trace. When the firmware is compiled with
+ * -finstrument-functions, GCC calls __cyg_profile_func_enter() and
+ * __cyg_profile_func_exit() around every function body; with
+ * FUNC_TRACE defined, those hooks append one (address, timestamp,
+ * enter/exit) event per call to a fixed-size RAM ring. host/profdecode.py
+ * --ftrace rebuilds the call tree and the duration of every call from
+ * a dump of the ring.
+ *
+ * To trace, add to the compiler flags of the build configuration:
+ *   -DFUNC_TRACE -finstrument-functions
+ *   -finstrument-functions-exclude-file-list=CMSIS,drivers,startup,board,utilities
+ * and narrow the exclusions to the code of interest. Hooks can be
+ * entered from interrupt handlers.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#ifndef _FUNC_TRACE_H_
+#define _FUNC_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Events kept; a power of two. Each takes 8 bytes of SRAM.
+ */
+#ifndef FUNC_TRACE_LEN
+#define FUNC_TRACE_LEN 256
+#endif
+
+#define FUNC_TRACE_MAGIC 0x31525446  // "FTR1" in memory
+#define FUNC_TRACE_EXIT  1u          // event[][0] bit 0: exit, not entry
+#define FUNC_TRACE_WRAP  1u          // flags: overwrite the oldest events
+
+#define FUNC_TRACE_NO_INSTRUMENT __attribute__((no_instrument_function))
+
+#ifdef FUNC_TRACE
+typedef struct {
+	uint32_t magic;                      // FUNC_TRACE_MAGIC
+	volatile uint32_t count;             // events claimed since the last reset
+	uint32_t capacity;                   // FUNC_TRACE_LEN
+	uint32_t cycle_hz;                   // timestamp rate, TICKTIME_CYCLE_HZ
+	uint32_t flags;                      // FUNC_TRACE_WRAP
+	uint32_t event[FUNC_TRACE_LEN][2];   // function address | exit bit, timestamp
+} FuncTrace;
+
+/*
+ * The ring, at count % capacity. Dump from the debugger with
+ *   dump binary value ftrace.bin func_trace
+ */
+extern FuncTrace func_trace;
+#endif
+
+/*
+ * Turns recording on or off. Events already recorded are kept.
+ */
+void func_trace_enable(bool on);
+
+/*
+ * Empties the ring and chooses what happens when it fills up.
+ *
+ * Parameters:
+ *   wrap   true to keep the newest FUNC_TRACE_LEN events, false to keep
+ *          the oldest and drop the rest
+ */
+void func_trace_reset(bool wrap);
+
+/*
+ * Prints the ring as one "FTRACE <hex>" line on the debug console,
+ * which profdecode.py --ftrace also accepts.
+ */
+void print_func_trace_dump(void);
+
+void __cyg_profile_func_enter(void *this_fn, void *call_site) FUNC_TRACE_NO_INSTRUMENT;
+void __cyg_profile_func_exit(void *this_fn, void *call_site) FUNC_TRACE_NO_INSTRUMENT;
+
+#endif /* _FUNC_TRACE_H_ */
@@ -0,0 +1,70 @@
+/**
+  * @file hash_algo.h
+  * @brief Streaming hash function interface
+  *
+  * HMAC and PBKDF2 are written against this interface rather than
+  * against ISHA directly, so that another hash can be plugged in by
+  * supplying its own HashAlgo descriptor.
+  *
+  * Modelled on the HashAlgo descriptor of CycloneCRYPTO Open
+  * (Copyright (C) 2010-2023 Oryx Embedded SARL, GPL-2.0-or-later).
+  *
+  * Author Suhas Srinivasa Reddy
+  **/
+
+ #ifndef _HASH_ALGO_H
+ #define _HASH_ALGO_H
+
+ //Dependencies
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+ //C++ guard
+ #ifdef __cplusplus
+ extern "C" {
+ #endif
+
+ //Streaming hash functions
+ typedef void (*HashAlgoInit)(void *context);
+ typedef void (*HashAlgoUpdate)(void *context, const void *data, size_t length);
+ typedef void (*HashAlgoFinal)(void *context, uint8_t *digest);
+
+ //Midstate of a context that has consumed a whole number of blocks
+ typedef bool (*HashAlgoSaveState)(const void *context, void *state);
+ typedef void (*HashAlgoRestoreState)(void *context, const void *state);
+
+ //Hash of (prefix saved in state) || (digestSize octets of data), in one step
+ typedef void (*HashAlgoFinalDigest)(const void *state, const uint8_t *data,
+    uint8_t *digest);
+
+
+ /**
+  * @brief Common interface for hash algorithms
+  *
+  * finalDigest is optional. When it is present, HMAC computations over a
+  * single digest (the PBKDF2 inner loop) skip the context entirely.
+  **/
+
+ typedef struct
+ {
+    const char *name;
+    size_t contextSize;
+    size_t stateSize;
+    size_t blockSize;
+    size_t digestSize;
+    HashAlgoInit init;
+    HashAlgoUpdate update;
+    HashAlgoFinal final;
+    HashAlgoSaveState saveState;
+    HashAlgoRestoreState restoreState;
+    HashAlgoFinalDigest finalDigest;
+ } HashAlgo;
+
+
+ //C++ guard
+ #ifdef __cplusplus
+ }
+ #endif
+
+ #endif
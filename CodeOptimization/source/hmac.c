@@ -0,0 +1,240 @@
+ /**
+  * @file hmac.c
+  * @brief HMAC (Keyed-Hashing for Message Authentication)
+  *
+  * @section License
+  *
+  * SPDX-License-Identifier: GPL-2.0-or-later
+  *
+  * Copyright (C) 2010-2023 Oryx Embedded SARL. All rights reserved.
+  *
+  * This file is part of CycloneCRYPTO Open.
+  *
+  * This program is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU General Public License
+  * as published by the Free Software Foundation; either version 2
+  * of the License, or (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program; if not, write to the Free Software Foundation,
+  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+  *
+  * @section Description
+  *
+  * HMAC is a mechanism for message authentication using cryptographic hash
+  * functions. HMAC can be used with any iterative cryptographic hash
+  * function (MD5, SHA-1 or SHA-256) in combination with a secret shared
+  * key. Refer to RFC 2104 for more details
+  *
+  * @author Oryx Embedded SARL (www.oryx-embedded.com)
+  * @version 2.2.4
+  *
+  * Modified by Suhas Srinivasa Reddy
+  * 	Keeps the hash midstates of the padded key instead of the key
+  *   itself, so that the pads are hashed once per key
+  **/
+
+
+ //Dependencies
+#include "hmac.h"
+#include "ramfunc.h"
+
+ //HMAC pads
+ #define HMAC_IPAD 0x36
+ #define HMAC_OPAD 0x5C
+
+
+ /**
+  * @brief Initialize HMAC calculation
+  *
+  * Hashes K XOR ipad and K XOR opad, one block each, and keeps the two
+  * resulting midstates. The context is then ready for hmacUpdate().
+  *
+  * @param[out] context Pointer to the HMAC context to initialize
+  * @param[in] hash Hash algorithm used to compute HMAC
+  * @param[in] key Key to use in the secret key
+  * @param[in] keyLen Length of the secret key
+  * @return Error code
+  **/
+
+ error_t hmacInit(HmacContext *context, const HashAlgo *hash,
+    const void *key, size_t keyLen)
+ {
+    size_t i;
+    uint8_t k[HMAC_MAX_BLOCK_SIZE];
+    uint8_t pad[HMAC_MAX_BLOCK_SIZE];
+
+    //Check parameters
+    if(context == NULL || hash == NULL || (key == NULL && keyLen != 0))
+       return ERROR_INVALID_PARAMETER;
+
+    //The hash context and midstate must fit in the storage reserved for them
+    if(hash->blockSize > HMAC_MAX_BLOCK_SIZE ||
+       hash->digestSize > HMAC_MAX_DIGEST_SIZE ||
+       hash->contextSize > sizeof(HashContext) ||
+       hash->stateSize > sizeof(HashState))
+    {
+       return ERROR_UNSUPPORTED_HASH_ALGO;
+    }
+
+    context->hash = hash;
+
+    //Keys longer than the block size are replaced by their hash
+    if(keyLen > hash->blockSize)
+    {
+       hash->init(&context->hashContext);
+       hash->update(&context->hashContext, key, keyLen);
+       hash->final(&context->hashContext, k);
+       keyLen = hash->digestSize;
+    }
+    else
+    {
+       for(i = 0; i < keyLen; i++)
+          k[i] = ((const uint8_t *) key)[i];
+    }
+
+    //Pad the key with zeros to the block size
+    for(i = keyLen; i < hash->blockSize; i++)
+       k[i] = 0;
+
+    //Midstate after K XOR opad
+    for(i = 0; i < hash->blockSize; i++)
+       pad[i] = k[i] ^ HMAC_OPAD;
+
+    hash->init(&context->hashContext);
+    hash->update(&context->hashContext, pad, hash->blockSize);
+    hash->saveState(&context->hashContext, &context->outerState);
+
+    //Midstate after K XOR ipad
+    for(i = 0; i < hash->blockSize; i++)
+       pad[i] = k[i] ^ HMAC_IPAD;
+
+    hash->init(&context->hashContext);
+    hash->update(&context->hashContext, pad, hash->blockSize);
+    hash->saveState(&context->hashContext, &context->innerState);
+
+    //The context is positioned right after K XOR ipad
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
+
+ /**
+  * @brief Start a new HMAC under the key given to hmacInit()
+  * @param[in] context Pointer to the HMAC context
+  **/
+
+ void hmacReset(HmacContext *context)
+ {
+    context->hash->restoreState(&context->hashContext, &context->innerState);
+ }
+
+
+ /**
+  * @brief Update the HMAC context with a portion of the message being hashed
+  * @param[in] context Pointer to the HMAC context
+  * @param[in] data Pointer to the buffer being hashed
+  * @param[in] length Length of the buffer
+  **/
+
+ void hmacUpdate(HmacContext *context, const void *data, size_t length)
+ {
+    context->hash->update(&context->hashContext, data, length);
+ }
+
+
+ /**
+  * @brief Finish the HMAC calculation
+  *
+  * The midstates are kept, so hmacReset() can start another HMAC under
+  * the same key.
+  *
+  * @param[in] context Pointer to the HMAC context
+  * @param[out] digest Calculated HMAC value (optional parameter)
+  **/
+
+ void hmacFinal(HmacContext *context, uint8_t *digest)
+ {
+    const HashAlgo *hash = context->hash;
+    uint8_t inner[HMAC_MAX_DIGEST_SIZE];
+
+    //H(K XOR ipad || m)
+    hash->final(&context->hashContext, inner);
+
+    //H(K XOR opad || H(K XOR ipad || m))
+    hash->restoreState(&context->hashContext, &context->outerState);
+    hash->update(&context->hashContext, inner, hash->digestSize);
+    hash->final(&context->hashContext, digest);
+ }
+
+
+ /**
+  * @brief HMAC of a message exactly one digest long
+  *
+  * This is the PBKDF2 inner loop. It only reads the context, so several
+  * threads may share one HmacContext, and it costs one hash of a single
+  * digest on each midstate (two compressions in all for ISHA).
+  *
+  * @param[in] context HMAC context set up by hmacInit()
+  * @param[in] data The message, digestSize octets
+  * @param[out] digest Calculated HMAC value; may be the same buffer as data
+  **/
+
+ ISHA_HOT void hmacDigest(const HmacContext *context, const uint8_t *data,
+    uint8_t *digest)
+ {
+    const HashAlgo *hash = context->hash;
+    HashContext hashContext;
+    uint8_t inner[HMAC_MAX_DIGEST_SIZE];
+
+    if(hash->finalDigest != NULL)
+    {
+       hash->finalDigest(&context->innerState, data, inner);
+       hash->finalDigest(&context->outerState, inner, digest);
+    }
+    else
+    {
+       hash->restoreState(&hashContext, &context->innerState);
+       hash->update(&hashContext, data, hash->digestSize);
+       hash->final(&hashContext, inner);
+
+       hash->restoreState(&hashContext, &context->outerState);
+       hash->update(&hashContext, inner, hash->digestSize);
+       hash->final(&hashContext, digest);
+    }
+ }
+
+
+ /**
+  * @brief Compute HMAC using the specified hash function
+  * @param[in] hash Hash algorithm used to compute HMAC
+  * @param[in] key Key to use in the secret key
+  * @param[in] keyLen Length of the secret key
+  * @param[in] data The input data for which to compute the hash code
+  * @param[in] dataLen Length of the input data
+  * @param[out] digest The computed HMAC value
+  * @return Error code
+  **/
+
+ error_t hmacCompute(const HashAlgo *hash, const void *key, size_t keyLen,
+    const void *data, size_t dataLen, uint8_t *digest)
+ {
+    error_t error;
+    HmacContext context;
+
+    error = hmacInit(&context, hash, key, keyLen);
+    if(error)
+       return error;
+
+    hmacUpdate(&context, data, dataLen);
+    hmacFinal(&context, digest);
+
+    //Successful processing
+    return NO_ERROR;
+ }
@@ -0,0 +1,100 @@
+/**
+  * @file hmac.h
+  * @brief HMAC (Keyed-Hashing for Message Authentication)
+  *
+  * @section License
+  *
+  * SPDX-License-Identifier: GPL-2.0-or-later
+  *
+  * Copyright (C) 2010-2023 Oryx Embedded SARL. All rights reserved.
+  *
+  * This file is part of CycloneCRYPTO Open.
+  *
+  * This program is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU General Public License
+  * as published by the Free Software Foundation; either version 2
+  * of the License, or (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program; if not, write to the Free Software Foundation,
+  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+  *
+  * @author Oryx Embedded SARL (www.oryx-embedded.com)
+  * @version 2.2.4
+  *
+  * Modified by Suhas Srinivasa Reddy
+  **/
+
+ #ifndef _HMAC_H
+ #define _HMAC_H
+
+ //Dependencies
+#include <stddef.h>
+#include <stdint.h>
+
+#include "error.h"
+#include "hash_algo.h"
+#include "isha.h"
+
+ //C++ guard
+ #ifdef __cplusplus
+ extern "C" {
+ #endif
+
+ //Largest block and digest of any supported hash algorithm
+ #define HMAC_MAX_BLOCK_SIZE ISHA_BLOCKLEN
+ #define HMAC_MAX_DIGEST_SIZE ISHA_DIGESTLEN
+
+ //Storage for the context or midstate of any supported hash algorithm
+ typedef union
+ {
+    ISHAContext isha;
+ } HashContext;
+
+ typedef union
+ {
+    ISHAState isha;
+ } HashState;
+
+
+ /**
+  * @brief HMAC algorithm context
+  *
+  * The hash midstates after K XOR ipad and K XOR opad are computed once
+  * by hmacInit(), and every later HMAC under the same key starts from
+  * them instead of hashing the padded key again.
+  **/
+
+ typedef struct
+ {
+    const HashAlgo *hash;
+    HashState innerState;
+    HashState outerState;
+    HashContext hashContext;
+ } HmacContext;
+
+ //HMAC related functions
+ error_t hmacInit(HmacContext *context, const HashAlgo *hash,
+    const void *key, size_t keyLen);
+ void hmacReset(HmacContext *context);
+ void hmacUpdate(HmacContext *context, const void *data, size_t length);
+ void hmacFinal(HmacContext *context, uint8_t *digest);
+
+ void hmacDigest(const HmacContext *context, const uint8_t *data,
+    uint8_t *digest);
+
+ error_t hmacCompute(const HashAlgo *hash, const void *key, size_t keyLen,
+    const void *data, size_t dataLen, uint8_t *digest);
+
+
+ //C++ guard
+ #ifdef __cplusplus
+ }
+ #endif
+
+ #endif
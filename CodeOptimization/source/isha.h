@@ -15,16 +15,19 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include "static_profiler.h"
+#include "hash_algo.h"
 
 #define ISHA_BLOCKLEN  64  // length of an ISHA block, in bytes
 #define ISHA_DIGESTLEN 20  // length of an ISHA digest, in bytes
+#define ISHA_ONESHOT_MAXLEN 55  // longest message isha_digest() accepts
+#define ISHA_MAX_LANES 16  // most messages an ISHAMultiContext hashes at once
 
-// This Macro is exposed to account for ISHAReset static profiling
-#define INCREMENT_STATIC_COUNT(variable, condition) \
-	    if (condition) { \
-	        variable++; \
-	    } \
+// Initial digest values, also loaded by ISHAReset.s
+#define ISHA_H0 0x67452301
+#define ISHA_H1 0xEFCDAB89
+#define ISHA_H2 0x98BADCFE
+#define ISHA_H3 0x10325476
+#define ISHA_H4 0xC3D2E1F0
 
 typedef struct {
 	uint32_t MD[5],      // Message Digest (output)
@@ -37,6 +40,34 @@ typedef struct {
 			Corrupted;         // Is the message digest corruped?
 } ISHAContext;
 
+/*
+ * Chaining state of an ISHAContext at a block boundary: everything
+ * needed to carry on hashing after a shared, block-aligned prefix.
+ */
+typedef struct {
+	uint32_t MD[5],      // Intermediate digest
+			Length_Low,   // Prefix length in bits
+			Length_High;
+} ISHAState;
+
+/*
+ * Hashes up to ISHA_MAX_LANES independent messages of the same length
+ * side by side. The digests are stored lane-interleaved so that each
+ * round runs across all lanes at once (AVX2 or SSE2 on the host, plain
+ * C elsewhere).
+ */
+typedef struct {
+	uint32_t MD[5][ISHA_MAX_LANES];  // MD[i][lane] is digest word i of a lane
+	uint32_t Length_Low,              // Per-lane message length in bits
+			Length_High;
+
+	uint8_t MBlock[ISHA_MAX_LANES][64];  // Per-lane 512-bit message blocks
+	int Lanes,                           // Number of lanes in use
+			MB_Idx,                      // Index into every lane's message block
+			Computed,                    // Are the digests computed?
+			Corrupted;                   // Are the message digests corrupted?
+} ISHAMultiContext;
+
 /*
  * Resets/initializes the given context back to its starting state, in
  * preparation for computing a new message digest
@@ -46,6 +77,36 @@ typedef struct {
  */
 extern void ISHAReset(ISHAContext *ctx);
 
+/*
+ * Compresses one 64-byte message block into a chaining value, in C.
+ * The reference for ISHACompressBlockAsm.
+ *
+ * Parameters:
+ *   MD      The chaining value; upon return, updated with the block (in/out)
+ *   block   The message block, big-endian words at any alignment (in)
+ */
+void ISHACompressBlock(uint32_t *MD, const uint8_t *block);
+
+/*
+ * Same as ISHACompressBlock, as a fully unrolled Thumb-1 kernel
+ * (ISHACompressBlock.S). block must be word aligned. ISHAInput and
+ * ISHAResult use it when built with ISHA_ASM_BLOCK=1 (default 0);
+ * host/isha_asm_tests.c checks it against the C version.
+ */
+void ISHACompressBlockAsm(uint32_t *MD, const uint8_t *block);
+
+/*
+ * The same kernel for a block already held as 16 host-order words, so
+ * without the byte swap. The single-block paths of isha.c, which build
+ * their padded block as words (isha_rehash_digest() for PBKDF1), use it
+ * when built with ISHA_ASM_BLOCK=1.
+ */
+void ISHACompressWordsAsm(uint32_t *MD, const uint32_t *W);
+
+#ifndef ISHA_ASM_BLOCK
+#define ISHA_ASM_BLOCK 0
+#endif
+
 /*
  * Computes the ISHA hash of the message, and returns the 20-byte hash
  * 
@@ -68,6 +129,128 @@ void ISHAResult(ISHAContext *ctx, uint8_t *digest_out);
  */
 void ISHAInput(ISHAContext *ctx, const uint8_t *bytes, size_t nbytes);
 
+/*
+ * Captures the midstate of a context that has consumed a whole number
+ * of blocks, so that messages sharing that prefix need only compress
+ * their suffix
+ *
+ * Parameters:
+ *   ctx     The ISHAContext (in)
+ *   state   Upon return, the saved midstate (out)
+ *
+ * Returns:
+ *   true on success, false if ctx is not at a block boundary, or has
+ *   already been finalized or corrupted
+ */
+bool ISHASaveState(const ISHAContext *ctx, ISHAState *state);
+
+/*
+ * Sets ctx up as if it had just consumed the prefix a midstate was
+ * saved from; use in place of ISHAReset
+ *
+ * Parameters:
+ *   ctx     The ISHAContext (out)
+ *   state   A midstate from ISHASaveState (in)
+ */
+void ISHARestoreState(ISHAContext *ctx, const ISHAState *state);
+
+/*
+ * Copies a context at any point of a message. Only the used part of
+ * the message block is copied.
+ *
+ * Parameters:
+ *   dst     The copy (out)
+ *   src     The ISHAContext to copy (in)
+ */
+void ISHACopy(ISHAContext *dst, const ISHAContext *src);
+
+/*
+ * Computes the ISHA hash of a message short enough to be padded into a
+ * single block, without an ISHAContext. Produces the same digest as
+ * ISHAReset/ISHAInput/ISHAResult.
+ *
+ * Parameters:
+ *   msg         The message (in)
+ *   msglen      Length of the message; at most ISHA_ONESHOT_MAXLEN (in)
+ *   digest_out  Upon return, the 20-byte message digest (out)
+ *
+ * Returns:
+ *   true on success, false if msglen is too long for a single block
+ */
+bool isha_digest(const uint8_t *msg, size_t msglen, uint8_t *digest_out);
+
+/*
+ * Replaces a 20-byte digest with the ISHA hash of itself, count times.
+ * This is the inner loop of PBKDF1, run on a fixed one-block kernel.
+ *
+ * Parameters:
+ *   digest  The 20-byte digest to be rehashed (in/out)
+ *   count   Number of times to apply the hash
+ */
+void isha_rehash_digest(uint8_t *digest, uint32_t count);
+
+/*
+ * Computes the ISHA hash of (the prefix a midstate was saved from) ||
+ * a 20-byte message, without an ISHAContext. This is one compression
+ * when the prefix is a whole number of blocks, as in HMAC.
+ *
+ * Parameters:
+ *   state       A midstate from ISHASaveState (in)
+ *   msg         The 20-byte message (in)
+ *   digest_out  Upon return, the 20-byte message digest (out); may be
+ *               the same buffer as msg
+ */
+void isha_digest_from_state(const ISHAState *state, const uint8_t *msg,
+		uint8_t *digest_out);
+
+/*
+ * ISHA as a HashAlgo, for hmac.c and pbkdf2()
+ */
+extern const HashAlgo ishaHashAlgo;
+
+/*
+ * Resets the given multi-lane context, in preparation for hashing
+ * lanes messages at once
+ *
+ * Parameters:
+ *   ctx    The ISHAMultiContext (in/out)
+ *   lanes  Number of messages, 1 to ISHA_MAX_LANES (in)
+ */
+void ISHAMultiReset(ISHAMultiContext *ctx, int lanes);
+
+/*
+ * Accepts the next nbytes of every lane's message
+ *
+ * Parameters:
+ *   ctx     The ISHAMultiContext (in/out)
+ *   bytes   One pointer per lane to the bytes to be processed (in)
+ *   nbytes  Number of bytes to be processed from each lane (in)
+ */
+void ISHAMultiInput(ISHAMultiContext *ctx, const uint8_t *const bytes[],
+		size_t nbytes);
+
+/*
+ * Computes the ISHA hash of every lane's message
+ *
+ * Parameters:
+ *   ctx         The ISHAMultiContext (in/out)
+ *   digest_out  One pointer per lane; upon return, each points to that
+ *               lane's 20-byte message digest (out)
+ */
+void ISHAMultiResult(ISHAMultiContext *ctx, uint8_t *const digest_out[]);
+
+/*
+ * Multi-lane isha_rehash_digest: replaces each lane's 20-byte digest
+ * with the ISHA hash of itself, count times
+ *
+ * Parameters:
+ *   digests  One pointer per lane to a 20-byte digest (in/out)
+ *   lanes    Number of digests, 1 to ISHA_MAX_LANES (in)
+ *   count    Number of times to apply the hash
+ */
+void isha_multi_rehash_digest(uint8_t *const digests[], int lanes,
+		uint32_t count);
+
 /*
  * Returns the start and end address in memory of a function. Specific to this
  * implementation.
@@ -0,0 +1,312 @@
+/*
+ * isha_multi.c
+ *
+ * Multi-buffer ISHA: hashes up to ISHA_MAX_LANES independent messages
+ * at once. A single ISHA message is one long dependency chain, so one
+ * message at a time leaves most of a superscalar core idle. Here every
+ * round is applied to a vector of lanes instead, using AVX2 (8 lanes
+ * per vector) or SSE2 (4 lanes) on the host. Other targets, including
+ * the KL25Z, get the plain C fallback with one lane per "vector".
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#include <string.h>
+#include "isha.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i vec_t;
+#define VEC_LANES 8
+#define VLOAD(p)       _mm256_loadu_si256((const __m256i *)(p))
+#define VSTORE(p, v)   _mm256_storeu_si256((__m256i *)(p), (v))
+#define VSET1(x)       _mm256_set1_epi32((int)(x))
+#define VADD(a, b)     _mm256_add_epi32((a), (b))
+#define VAND(a, b)     _mm256_and_si256((a), (b))
+#define VANDNOT(a, b)  _mm256_andnot_si256((a), (b))  // (~a) & b
+#define VOR(a, b)      _mm256_or_si256((a), (b))
+#define VROL(bits, x)  VOR(_mm256_slli_epi32((x), (bits)), \
+                           _mm256_srli_epi32((x), 32 - (bits)))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i vec_t;
+#define VEC_LANES 4
+#define VLOAD(p)       _mm_loadu_si128((const __m128i *)(p))
+#define VSTORE(p, v)   _mm_storeu_si128((__m128i *)(p), (v))
+#define VSET1(x)       _mm_set1_epi32((int)(x))
+#define VADD(a, b)     _mm_add_epi32((a), (b))
+#define VAND(a, b)     _mm_and_si128((a), (b))
+#define VANDNOT(a, b)  _mm_andnot_si128((a), (b))     // (~a) & b
+#define VOR(a, b)      _mm_or_si128((a), (b))
+#define VROL(bits, x)  VOR(_mm_slli_epi32((x), (bits)), \
+                           _mm_srli_epi32((x), 32 - (bits)))
+#else
+typedef uint32_t vec_t;
+#define VEC_LANES 1
+#define VLOAD(p)       (*(p))
+#define VSTORE(p, v)   (*(p) = (v))
+#define VSET1(x)       ((uint32_t)(x))
+#define VADD(a, b)     ((a) + (b))
+#define VAND(a, b)     ((a) & (b))
+#define VANDNOT(a, b)  ((~(a)) & (b))
+#define VOR(a, b)      ((a) | (b))
+#define VROL(bits, x)  (((x) << (bits)) | ((x) >> (32 - (bits))))
+#endif
+
+/*
+ * One ISHA round across a vector of lanes; the vector form of
+ * ISHA_ROUND in isha.c
+ */
+#define VROUND(w) \
+  do { \
+    temp = VADD(VADD(VROL(5, A), VOR(VAND(B, C), VANDNOT(B, D))), VADD(E, (w))); \
+    E = VROL(25, D); \
+    D = VROL(15, C); \
+    C = VROL(30, B); \
+    B = VROL(10, A); \
+    A = VROL(5, temp); \
+  } while (0)
+
+// Same round for a message word known to be zero
+#define VROUND0() \
+  do { \
+    temp = VADD(VADD(VROL(5, A), VOR(VAND(B, C), VANDNOT(B, D))), E); \
+    E = VROL(25, D); \
+    D = VROL(15, C); \
+    C = VROL(30, B); \
+    B = VROL(10, A); \
+    A = VROL(5, temp); \
+  } while (0)
+
+/*
+ * Reads a big-endian word from p, which need not be aligned
+ */
+static inline uint32_t ISHALoadBE32(const uint8_t *p) {
+	return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8
+			| p[3];
+}
+
+/*
+ * Compresses one block per lane into MD. W[t][lane] is message word t
+ * of a lane, in host order. Lanes are processed VEC_LANES at a time;
+ * the arrays are ISHA_MAX_LANES wide, so a partly used last vector just
+ * computes on the unused lanes.
+ */
+static void ISHAMultiCompress(uint32_t MD[5][ISHA_MAX_LANES],
+		uint32_t W[16][ISHA_MAX_LANES], int lanes) {
+	for (int l = 0; l < lanes; l += VEC_LANES) {
+		vec_t A, B, C, D, E, temp;
+
+		A = VLOAD(&MD[0][l]);
+		B = VLOAD(&MD[1][l]);
+		C = VLOAD(&MD[2][l]);
+		D = VLOAD(&MD[3][l]);
+		E = VLOAD(&MD[4][l]);
+
+		for (int t = 0; t < 16; t++) {
+			VROUND(VLOAD(&W[t][l]));
+		}
+
+		VSTORE(&MD[0][l], VADD(VLOAD(&MD[0][l]), A));
+		VSTORE(&MD[1][l], VADD(VLOAD(&MD[1][l]), B));
+		VSTORE(&MD[2][l], VADD(VLOAD(&MD[2][l]), C));
+		VSTORE(&MD[3][l], VADD(VLOAD(&MD[3][l]), D));
+		VSTORE(&MD[4][l], VADD(VLOAD(&MD[4][l]), E));
+	}
+}
+
+/*
+ * Transposes every lane's MBlock into words and compresses it
+ */
+static void ISHAMultiProcessMessageBlock(ISHAMultiContext *ctx) {
+	uint32_t W[16][ISHA_MAX_LANES];
+
+	for (int t = 0; t < 16; t++) {
+		for (int l = 0; l < ISHA_MAX_LANES; l++) {
+			W[t][l] = ISHALoadBE32(&ctx->MBlock[l][4 * t]);
+		}
+	}
+
+	ISHAMultiCompress(ctx->MD, W, ctx->Lanes);
+	ctx->MB_Idx = 0;
+}
+
+void ISHAMultiReset(ISHAMultiContext *ctx, int lanes) {
+	memset(ctx, 0, sizeof(*ctx));
+
+	for (int l = 0; l < ISHA_MAX_LANES; l++) {
+		ctx->MD[0][l] = ISHA_H0;
+		ctx->MD[1][l] = ISHA_H1;
+		ctx->MD[2][l] = ISHA_H2;
+		ctx->MD[3][l] = ISHA_H3;
+		ctx->MD[4][l] = ISHA_H4;
+	}
+
+	ctx->Lanes = lanes;
+	if (lanes < 1 || lanes > ISHA_MAX_LANES) {
+		ctx->Corrupted = 1;
+	}
+}
+
+void ISHAMultiInput(ISHAMultiContext *ctx, const uint8_t *const bytes[],
+		size_t nbytes) {
+	size_t offset = 0;
+
+	if (!nbytes) {
+		return;
+	}
+
+	if (ctx->Computed || ctx->Corrupted) {
+		ctx->Corrupted = 1;
+		return;
+	}
+
+	while (nbytes > 0 && !ctx->Corrupted) {
+		size_t blockRemaining = 64 - ctx->MB_Idx;
+		size_t bytesToCopy = (nbytes < blockRemaining) ? nbytes : blockRemaining;
+
+		for (int l = 0; l < ctx->Lanes; l++) {
+			memcpy(&ctx->MBlock[l][ctx->MB_Idx], bytes[l] + offset, bytesToCopy);
+		}
+
+		ctx->MB_Idx += bytesToCopy;
+		offset += bytesToCopy;
+		nbytes -= bytesToCopy;
+
+		ctx->Length_Low += 8 * bytesToCopy;
+		if (ctx->Length_Low < 8 * bytesToCopy) {   // Length_Low overflowed
+			ctx->Length_High++;
+			if (ctx->Length_High == 0) {
+				ctx->Corrupted = 1;
+			}
+		}
+
+		if (ctx->MB_Idx == 64) {
+			ISHAMultiProcessMessageBlock(ctx);
+		}
+	}
+}
+
+/*
+ * Pads every lane exactly as ISHAPadMessage does. All lanes have the
+ * same length, so they all pad at the same index.
+ */
+static void ISHAMultiPadMessage(ISHAMultiContext *ctx) {
+	int idx = ctx->MB_Idx;
+
+	for (int l = 0; l < ISHA_MAX_LANES; l++) {
+		ctx->MBlock[l][idx] = 0x80;
+	}
+	idx++;
+
+	if (idx > 56) {
+		for (int l = 0; l < ISHA_MAX_LANES; l++) {
+			memset(&ctx->MBlock[l][idx], 0, 64 - idx);
+		}
+		ISHAMultiProcessMessageBlock(ctx);
+		idx = 0;
+	}
+
+	for (int l = 0; l < ISHA_MAX_LANES; l++) {
+		uint8_t *block = ctx->MBlock[l];
+
+		memset(&block[idx], 0, 56 - idx);
+		for (int i = 0; i < 4; i++) {
+			block[56 + i] = ctx->Length_High >> (24 - 8 * i);
+			block[60 + i] = ctx->Length_Low >> (24 - 8 * i);
+		}
+	}
+
+	ISHAMultiProcessMessageBlock(ctx);
+}
+
+void ISHAMultiResult(ISHAMultiContext *ctx, uint8_t *const digest_out[]) {
+	if (ctx->Corrupted) {
+		return;
+	}
+
+	if (!ctx->Computed) {
+		ISHAMultiPadMessage(ctx);
+		ctx->Computed = 1;
+	}
+
+	for (int l = 0; l < ctx->Lanes; l++) {
+		uint8_t *out = digest_out[l];
+
+		for (int i = 0; i < 5; i++) {
+			*out++ = ctx->MD[i][l] >> 24;
+			*out++ = ctx->MD[i][l] >> 16;
+			*out++ = ctx->MD[i][l] >> 8;
+			*out++ = ctx->MD[i][l];
+		}
+	}
+}
+
+/*
+ * Multi-lane form of isha_rehash_digest. Each vector of lanes keeps its
+ * digests in registers for all count iterations; the constant words
+ * 5-15 of the padded 20-byte block are folded into the rounds.
+ */
+void isha_multi_rehash_digest(uint8_t *const digests[], int lanes,
+		uint32_t count) {
+	uint32_t MD[5][ISHA_MAX_LANES] = { { 0 } };
+
+	if (count == 0 || lanes < 1 || lanes > ISHA_MAX_LANES) {
+		return;
+	}
+
+	for (int l = 0; l < lanes; l++) {
+		for (int i = 0; i < 5; i++) {
+			MD[i][l] = ISHALoadBE32(digests[l] + 4 * i);
+		}
+	}
+
+	for (int l = 0; l < lanes; l += VEC_LANES) {
+		vec_t A, B, C, D, E, temp;
+		vec_t M0 = VLOAD(&MD[0][l]), M1 = VLOAD(&MD[1][l]),
+				M2 = VLOAD(&MD[2][l]), M3 = VLOAD(&MD[3][l]),
+				M4 = VLOAD(&MD[4][l]);
+
+		for (uint32_t n = 0; n < count; n++) {
+			A = VSET1(ISHA_H0);
+			B = VSET1(ISHA_H1);
+			C = VSET1(ISHA_H2);
+			D = VSET1(ISHA_H3);
+			E = VSET1(ISHA_H4);
+
+			VROUND(M0);
+			VROUND(M1);
+			VROUND(M2);
+			VROUND(M3);
+			VROUND(M4);
+			VROUND(VSET1(0x80000000));
+			for (int t = 6; t < 15; t++) {
+				VROUND0();
+			}
+			VROUND(VSET1(ISHA_DIGESTLEN * 8));
+
+			M0 = VADD(VSET1(ISHA_H0), A);
+			M1 = VADD(VSET1(ISHA_H1), B);
+			M2 = VADD(VSET1(ISHA_H2), C);
+			M3 = VADD(VSET1(ISHA_H3), D);
+			M4 = VADD(VSET1(ISHA_H4), E);
+		}
+
+		VSTORE(&MD[0][l], M0);
+		VSTORE(&MD[1][l], M1);
+		VSTORE(&MD[2][l], M2);
+		VSTORE(&MD[3][l], M3);
+		VSTORE(&MD[4][l], M4);
+	}
+
+	for (int l = 0; l < lanes; l++) {
+		uint8_t *out = digests[l];
+
+		for (int i = 0; i < 5; i++) {
+			*out++ = MD[i][l] >> 24;
+			*out++ = MD[i][l] >> 16;
+			*out++ = MD[i][l] >> 8;
+			*out++ = MD[i][l];
+		}
+	}
+}
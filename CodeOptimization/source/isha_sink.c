@@ -0,0 +1,75 @@
+/*
+ * isha_sink.c
+ *
+ * Hash-while-receiving on top of cbfifo and ISHAInput. See isha_sink.h.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#include "isha_sink.h"
+#include "ticktime.h"
+
+void isha_sink_init(IshaSink *sink, uint32_t length) {
+	ISHAReset(&sink->ctx);
+	sink->length = length;
+	sink->bytes = 0;
+	sink->busy_us = 0;
+	sink->done_us = 0;
+	sink->done = false;
+}
+
+bool isha_sink_poll(IshaSink *sink, Buffer *ring) {
+	uint8_t *block = (uint8_t *) sink->block;
+	uint32_t start, left, n;
+	char *data;
+	bool hashed = false;
+
+	if (sink->done) {
+		return true;
+	}
+
+	start = ticktime_us();
+	left = sink->length - sink->bytes;
+
+	// Whole blocks, while at least one more byte of the stream follows,
+	// so the tail is never split across two polls. ctx holds no partial
+	// block, so ISHAInput compresses them straight from the ring; only a
+	// block split by the end of the storage goes through the staging copy.
+	while (left > ISHA_BLOCKLEN) {
+		n = cbfifo_peek_contiguous(ring, &data);
+		if (n > left - 1) {
+			n = left - 1;
+		}
+		n &= ~(uint32_t) (ISHA_BLOCKLEN - 1);
+		if (n) {
+			ISHAInput(&sink->ctx, (const uint8_t *) data, n);
+			cbfifo_commit(ring, n);
+		} else if (cbfifo_length(ring) >= ISHA_BLOCKLEN) {
+			n = cbfifo_dequeue(ring, block, ISHA_BLOCKLEN);
+			ISHAInput(&sink->ctx, block, n);
+		} else {
+			break;
+		}
+		sink->bytes += n;
+		left -= n;
+		hashed = true;
+	}
+
+	// The tail, once all of it is here
+	if (left <= ISHA_BLOCKLEN && cbfifo_length(ring) >= left) {
+		n = cbfifo_dequeue(ring, block, left);
+		ISHAInput(&sink->ctx, block, n);
+		ISHAResult(&sink->ctx, sink->digest);
+		sink->bytes += n;
+		sink->done = true;
+		hashed = true;
+	}
+
+	// Only polls that hashed something count as busy, so busy_us measures
+	// hashing throughput rather than the time spent waiting for input
+	if (hashed) {
+		sink->done_us = ticktime_us();
+		sink->busy_us += sink->done_us - start;
+	}
+	return sink->done;
+}
@@ -0,0 +1,62 @@
+/*
+ * isha_sink.h
+ *
+ * Hashes a byte stream as it arrives in a cbfifo ring, such as the
+ * UART receive ring, instead of buffering the whole payload first.
+ * Each call to isha_sink_poll() from the main loop compresses the whole
+ * blocks that are waiting, in place in the ring, so when the last byte
+ * arrives at most one block and the padding are left to do.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#ifndef _ISHA_SINK_H_
+#define _ISHA_SINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cbfifo.h"
+#include "isha.h"
+
+typedef struct {
+	ISHAContext ctx;
+	uint32_t length;                 // bytes expected
+	uint32_t bytes;                  // bytes hashed so far
+	uint32_t busy_us;                // time spent in isha_sink_poll() hashing
+	uint32_t done_us;                // ticktime_us() when the digest was ready
+	uint8_t digest[ISHA_DIGESTLEN];  // valid once done
+	uint32_t block[ISHA_BLOCKLEN / 4];  // staging for a wrapped block or the tail
+	bool done;
+} IshaSink;
+
+// ISHAResult() stores the digest a word at a time, which faults on the
+// Cortex-M0+ unless it is word aligned
+_Static_assert(offsetof(IshaSink, digest) % sizeof(uint32_t) == 0,
+		"IshaSink.digest must be word aligned");
+
+/*
+ * Starts hashing a stream of a known length.
+ *
+ * Parameters:
+ *   sink     The sink (out)
+ *   length   Number of bytes that will arrive
+ */
+void isha_sink_init(IshaSink *sink, uint32_t length);
+
+/*
+ * Hashes what has arrived: every whole block waiting in ring, and, once
+ * the rest of the stream is there, the tail and the padding. Bytes past
+ * the expected length are left in the ring.
+ *
+ * Parameters:
+ *   sink     The sink (in/out)
+ *   ring     Ring the stream arrives in
+ *
+ * Returns:
+ *   true once the digest is in sink->digest
+ */
+bool isha_sink_poll(IshaSink *sink, Buffer *ring);
+
+#endif /* _ISHA_SINK_H_ */
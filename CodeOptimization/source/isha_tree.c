@@ -0,0 +1,155 @@
+/*
+ * isha_tree.c
+ *
+ * ISHA-Tree version 1. See isha_tree.h for the definition of the mode.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#include "isha_tree.h"
+
+#define LEAF_PREFIX 0x00
+#define NODE_PREFIX 0x01
+#define ROOT_PREFIX 0x02
+
+/*
+ * Hashes two subtree roots into their parent node
+ */
+static void ISHATreeNode(const uint8_t *left, const uint8_t *right,
+		uint8_t *digest_out) {
+	uint8_t msg[1 + 2 * ISHA_DIGESTLEN];
+	int i;
+
+	msg[0] = NODE_PREFIX;
+	for (i = 0; i < ISHA_DIGESTLEN; i++) {
+		msg[1 + i] = left[i];
+		msg[1 + ISHA_DIGESTLEN + i] = right[i];
+	}
+	isha_digest(msg, sizeof(msg), digest_out);
+}
+
+/*
+ * Pushes a leaf hash and merges every subtree it completes. After k
+ * leaves the stack holds one perfect subtree per set bit of k, largest
+ * at the bottom, which is what yields the left-balanced shape.
+ */
+static void ISHATreePush(ISHATreeContext *ctx, const uint8_t *leaf) {
+	uint64_t n;
+	int i;
+
+	for (i = 0; i < ISHA_DIGESTLEN; i++) {
+		ctx->Stack[ctx->Depth][i] = leaf[i];
+	}
+	ctx->Depth++;
+	ctx->Leaves++;
+
+	for (n = ctx->Leaves; (n & 1) == 0; n >>= 1) {
+		ctx->Depth--;
+		ISHATreeNode(ctx->Stack[ctx->Depth - 1], ctx->Stack[ctx->Depth],
+				ctx->Stack[ctx->Depth - 1]);
+	}
+}
+
+static void ISHATreeStartLeaf(ISHATreeContext *ctx) {
+	static const uint8_t prefix = LEAF_PREFIX;
+
+	ISHAReset(&ctx->Leaf);
+	ISHAInput(&ctx->Leaf, &prefix, 1);
+	ctx->Leaf_Fill = 0;
+}
+
+static void ISHATreeFinishLeaf(ISHATreeContext *ctx) {
+	uint8_t digest[ISHA_DIGESTLEN];
+
+	ISHAResult(&ctx->Leaf, digest);
+	ISHATreePush(ctx, digest);
+}
+
+void ISHATreeReset(ISHATreeContext *ctx) {
+	ctx->Leaves = 0;
+	ctx->Length = 0;
+	ctx->Depth = 0;
+	ctx->Computed = 0;
+	ISHATreeStartLeaf(ctx);
+}
+
+void ISHATreeInput(ISHATreeContext *ctx, const uint8_t *bytes, size_t nbytes) {
+	size_t n;
+
+	if (ctx->Computed) {
+		return;
+	}
+
+	ctx->Length += nbytes;
+	while (nbytes > 0) {
+		// A full leaf is only closed once more data arrives, so that the
+		// message never ends with a spurious empty leaf
+		if (ctx->Leaf_Fill == ISHA_TREE_LEAFLEN) {
+			ISHATreeFinishLeaf(ctx);
+			ISHATreeStartLeaf(ctx);
+		}
+
+		n = ISHA_TREE_LEAFLEN - ctx->Leaf_Fill;
+		if (nbytes < n) {
+			n = nbytes;
+		}
+
+		ISHAInput(&ctx->Leaf, bytes, n);
+		ctx->Leaf_Fill += n;
+		bytes += n;
+		nbytes -= n;
+	}
+}
+
+void isha_tree_leaf(const uint8_t *bytes, size_t nbytes, uint8_t *digest_out) {
+	static const uint8_t prefix = LEAF_PREFIX;
+	ISHAContext leaf;
+
+	ISHAReset(&leaf);
+	ISHAInput(&leaf, &prefix, 1);
+	ISHAInput(&leaf, bytes, nbytes);
+	ISHAResult(&leaf, digest_out);
+}
+
+void ISHATreeAddLeaf(ISHATreeContext *ctx, const uint8_t *leaf, size_t nbytes) {
+	if (ctx->Computed) {
+		return;
+	}
+
+	ctx->Length += nbytes;
+	ISHATreePush(ctx, leaf);
+}
+
+void ISHATreeResult(ISHATreeContext *ctx, uint8_t *digest_out) {
+	uint8_t msg[2 + 8 + ISHA_DIGESTLEN];
+	int i;
+
+	if (!ctx->Computed) {
+		// The last, partial leaf; or the single empty leaf of an empty message
+		if (ctx->Leaf_Fill > 0 || ctx->Leaves == 0) {
+			ISHATreeFinishLeaf(ctx);
+		}
+
+		// Fold the pending subtrees, smallest (rightmost) first
+		while (ctx->Depth > 1) {
+			ctx->Depth--;
+			ISHATreeNode(ctx->Stack[ctx->Depth - 1], ctx->Stack[ctx->Depth],
+					ctx->Stack[ctx->Depth - 1]);
+		}
+
+		msg[0] = ROOT_PREFIX;
+		msg[1] = ISHA_TREE_VERSION;
+		for (i = 0; i < 8; i++) {
+			msg[2 + i] = ctx->Length >> (56 - 8 * i);
+		}
+		for (i = 0; i < ISHA_DIGESTLEN; i++) {
+			msg[10 + i] = ctx->Stack[0][i];
+		}
+		isha_digest(msg, sizeof(msg), ctx->Stack[0]);
+		ctx->Computed = 1;
+	}
+
+	for (i = 0; i < ISHA_DIGESTLEN; i++) {
+		digest_out[i] = ctx->Stack[0][i];
+	}
+}
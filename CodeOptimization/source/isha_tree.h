@@ -0,0 +1,95 @@
+/*
+ * isha_tree.h
+ *
+ * ISHA-Tree: a tree hash mode layered on ISHAContext, so that large
+ * inputs can be hashed on many cores at once. It is a different hash
+ * from plain ISHA; the two never produce the same digest.
+ *
+ * ISHA-Tree version 1, for a message of n bytes:
+ *
+ *   - The message is split into leaves of ISHA_TREE_LEAFLEN bytes; the
+ *     last leaf may be shorter. An empty message is one empty leaf.
+ *   - leaf  = ISHA(0x00 || leaf bytes)
+ *   - node  = ISHA(0x01 || left || right)
+ *   - Leaves are combined into a left-balanced binary tree: the left
+ *     subtree of any node holds the largest power of two of leaves
+ *     that is strictly less than the node's leaf count.
+ *   - digest = ISHA(0x02 || ISHA_TREE_VERSION || n as 8 bytes
+ *                  big-endian || root)
+ *
+ * Leaves are independent, so callers may hash them in parallel with
+ * isha_tree_leaf() and feed the results, in order, to
+ * ISHATreeAddLeaf(). ISHATreeInput() does the same serially.
+ */
+
+#ifndef _ISHA_TREE_H_
+#define _ISHA_TREE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "isha.h"
+
+#define ISHA_TREE_VERSION  1
+#define ISHA_TREE_LEAFLEN  (64 * 1024)  // leaf size, in bytes
+#define ISHA_TREE_MAXDEPTH 64           // enough for 2^64 leaves
+
+typedef struct {
+	ISHAContext Leaf;                 // Hash of the leaf being filled
+	size_t Leaf_Fill;                 // Bytes in the current leaf
+	uint64_t Leaves,                  // Completed leaves
+			Length;                   // Message length in bytes
+	uint8_t Stack[ISHA_TREE_MAXDEPTH][ISHA_DIGESTLEN];  // Pending subtree roots
+	int Depth;                        // Entries on Stack
+	int Computed;                     // Is the digest computed?
+} ISHATreeContext;
+
+/*
+ * Resets the context, in preparation for a new ISHA-Tree digest
+ *
+ * Parameters:
+ *   ctx         The ISHATreeContext (in/out)
+ */
+void ISHATreeReset(ISHATreeContext *ctx);
+
+/*
+ * Accepts the next nbytes of the message
+ *
+ * Parameters:
+ *   ctx     The ISHATreeContext (in/out)
+ *   bytes   Pointer to the bytes to be processed (in)
+ *   nbytes  Number of bytes to be processed (in)
+ */
+void ISHATreeInput(ISHATreeContext *ctx, const uint8_t *bytes, size_t nbytes);
+
+/*
+ * Hashes one leaf. Safe to call from several threads at once.
+ *
+ * Parameters:
+ *   bytes       The leaf (in)
+ *   nbytes      Length of the leaf; ISHA_TREE_LEAFLEN for every leaf
+ *               but the last (in)
+ *   digest_out  Upon return, the 20-byte leaf hash (out)
+ */
+void isha_tree_leaf(const uint8_t *bytes, size_t nbytes, uint8_t *digest_out);
+
+/*
+ * Adds the next leaf, already hashed with isha_tree_leaf(). Must not be
+ * mixed with ISHATreeInput() on the same context.
+ *
+ * Parameters:
+ *   ctx     The ISHATreeContext (in/out)
+ *   leaf    The 20-byte leaf hash (in)
+ *   nbytes  Length of the leaf it was computed from (in)
+ */
+void ISHATreeAddLeaf(ISHATreeContext *ctx, const uint8_t *leaf, size_t nbytes);
+
+/*
+ * Computes the ISHA-Tree digest of the message
+ *
+ * Parameters:
+ *   ctx         The ISHATreeContext (in/out)
+ *   digest_out  Upon return, the 20-byte digest (out)
+ */
+void ISHATreeResult(ISHATreeContext *ctx, uint8_t *digest_out);
+
+#endif
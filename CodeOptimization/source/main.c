@@ -17,12 +17,26 @@
 #include "fsl_debug_console.h"
 
 #include "pbkdf1.h"
+#include "pbkdf1_calibrate.h"
 #include "pbkdf1_test.h"
 #include "ticktime.h"
+#include "func_trace.h"
+#include "isha.h"
+#include "ramfunc.h"
+#include "fastdiv.h"
+#include "bench.h"
+#include "cbfifo.h"
+#include "uart_rx.h"
+#ifdef HASH_UPLOAD
+#include "isha_sink.h"
+#endif
 
 #include "static_profiler.h"
 
-#define DIVIDE_BY_TEN(x) (((x) >> 3) + (((x) + ((x) << 1)) >> 1))
+#define PBKDF1_BUDGET_MS 100  // latency budget for the calibrated iteration count
+#define SRAM_START 0x1FFFF000   // SRAM_L and SRAM_U, 16 KB in all
+#define SRAM_END   0x20003000
+#define CONSOLE_LINE_LEN 64
 
 // Function to Calculate length of string  written to avoid importing string.h
 size_t strlen(const char *__s) {
@@ -52,6 +66,7 @@ static void time_pbkdf1(bool print_time) {
 	const char *exp_result_hex = "E9C8B4E075D3BB7652204AD6CBBE19B44051EFB4";
 
 	ticktime_t duration = 0;
+	uint32_t start_us, duration_us;
 
 	assert(dk_len <= sizeof(act_result));
 
@@ -60,28 +75,145 @@ static void time_pbkdf1(bool print_time) {
 	saltlen = strlen(salt);
 
 	reset_timer();
+	start_us = ticktime_us();
 	error_t err = pbkdf1((const uint8_t*) pass, passlen, (const uint8_t*) salt,
 			saltlen, iterations, act_result, dk_len);
+	duration_us = ticktime_us() - start_us;
 	duration = get_timer();
 
 	if ((err == NO_ERROR) && cmp_bin(act_result, exp_result, dk_len)) {
 		if (print_time) {
-			PRINTF("%s: %u iterations took %u msec\r\n", __FUNCTION__,
-					iterations, duration / 10);
+			PRINTF("%s: %u iterations took %u msec (%u usec)\r\n", __FUNCTION__,
+					iterations, udiv10(duration), duration_us);
 		} else {
-			PRINTF("%s: %u iterations complete\r\n", __FUNCTION__, iterations,
-					duration / 10);
+			PRINTF("%s: %u iterations complete\r\n", __FUNCTION__, iterations);
 		}
 	} else {
 		if (print_time) {
 			PRINTF("FAILURE on timed test duration=%u msec\r\n",
-					DIVIDE_BY_TEN(duration));
+					udiv10(duration));
 		} else {
-			PRINTF("FAILURE on tests.\r\n", DIVIDE_BY_TEN(duration));
+			PRINTF("FAILURE on tests.\r\n");
+		}
+	}
+}
+
+/*
+ * Reports where the ISHA hot path runs from, for comparing the
+ * ISHA_IN_RAM build with the flash-resident one. Warns if ISHA_IN_RAM
+ * is set but the linker left the code in flash.
+ */
+static void print_isha_placement(void) {
+	uint32_t addr = (uint32_t) isha_rehash_digest & ~1u;
+	bool in_sram = addr >= SRAM_START && addr < SRAM_END;
+
+	PRINTF("ISHA hot path in %s (isha_rehash_digest at 0x%08x)\r\n",
+			in_sram ? "SRAM" : "flash", addr);
+	if (ISHA_IN_RAM && !in_sram) {
+		PRINTF("WARNING: ISHA_IN_RAM set but .ramfunc was not placed in SRAM\r\n");
+	}
+}
+
+#ifdef HASH_UPLOAD
+/*
+ * Reads a decimal length terminated by LF from rx_buffer, waiting for
+ * it to arrive. A CR before the LF is skipped, so the data starts right
+ * after the LF.
+ */
+static uint32_t read_upload_length(void) {
+	uint32_t length = 0;
+	char ch;
+
+	for (;;) {
+		if (!cbfifo_dequeue(&rx_buffer, &ch, 1))
+			continue;
+		if (ch >= '0' && ch <= '9')
+			length = length * 10 + (ch - '0');
+		else if (ch == '\n' && length)
+			return length;
+	}
+}
+
+/*
+ * Hashes an upload over UART0 as it arrives: the host sends the length
+ * on a line of its own, then that many bytes, e.g.
+ *   (stat -c %s f; cat f) > /dev/ttyACM0
+ * and checks the digest against isha_treesum -p f.
+ */
+static void hash_upload(void) {
+	static IshaSink sink;
+	uint32_t length, line_us, latency_us, i;
+
+	// Clears rx_buffer and the counters before the prompt; nothing after
+	// it is discarded
+	Init_UART0_Rx();
+	PRINTF("Send the length in bytes, a newline, then the data\r\n");
+	length = read_upload_length();
+
+	isha_sink_init(&sink, length);
+	while (!isha_sink_poll(&sink, &rx_buffer))
+		;
+
+	for (i = 0; i < ISHA_DIGESTLEN; i++)
+		PRINTF("%02x", sink.digest[i]);
+	PRINTF("\r\n");
+
+	line_us = uart_rx_last_us - uart_rx_first_us;
+	latency_us = sink.done_us - uart_rx_last_us;
+	PRINTF("%u bytes in %u usec (%u bytes/sec)\r\n", length, line_us,
+			line_us ? (uint32_t) ((uint64_t) length * 1000000 / line_us) : 0);
+	PRINTF("hashing busy %u usec (%u bytes/sec), digest %u usec after the last byte\r\n",
+			sink.busy_us,
+			sink.busy_us ? (uint32_t) ((uint64_t) length * 1000000 / sink.busy_us) : 0,
+			latency_us);
+	PRINTF("%u bytes dropped, %u receive errors\r\n", uart_rx_dropped,
+			uart_rx_errors);
+}
+#endif
+
+/*
+ * Reads one line from rx_buffer into line, echoing it, and waits for
+ * it to arrive. Backspace edits; characters past len - 1 are dropped.
+ */
+static void read_line(char *line, size_t len) {
+	size_t n = 0;
+	char ch;
+
+	for (;;) {
+		if (!cbfifo_dequeue(&rx_buffer, &ch, 1))
+			continue;
+		if (ch == '\r' || ch == '\n') {
+			PRINTF("\r\n");
+			line[n] = '\0';
+			return;
+		}
+		if ((ch == '\b' || ch == 0x7F) && n > 0) {
+			n--;
+			PRINTF("\b \b");
+		} else if (ch >= ' ' && ch < 0x7F && n < len - 1) {
+			line[n++] = ch;
+			PUTCHAR(ch);
 		}
 	}
 }
 
+/*
+ * Runs benchmark commands typed on the debug console, forever. See
+ * bench.h for the commands.
+ */
+static void bench_console(void) {
+	char line[CONSOLE_LINE_LEN];
+
+	Init_UART0_Rx();
+	PRINTF("Benchmarks: bench list | bench all [reps] | bench <name> [arg [reps]]\r\n");
+	for (;;) {
+		PRINTF("> ");
+		read_line(line, sizeof(line));
+		if (line[0])
+			bench_command(line);
+	}
+}
+
 /*
  * Run all the validity checks; exit on failure
  */
@@ -90,6 +222,11 @@ static void run_tests() {
 
 	success &= test_isha();
 	success &= test_pbkdf1();
+	success &= test_isha_multi();
+	success &= test_pbkdf1_batch();
+	success &= test_isha_tree();
+	success &= test_pbkdf2();
+	success &= test_pbkdf1_calibrate();
 
 	if (success)
 		return;
@@ -118,8 +255,13 @@ int main(void) {
 	run_tests();
 	PRINTF("All tests passed!\r\n");
 
+	PRINTF("ISHA throughput: %u blocks/sec, %u iterations fit in %u msec\r\n",
+			pbkdf1_blocks_per_sec(),
+			pbkdf1_iterations_for_budget(PBKDF1_BUDGET_MS), PBKDF1_BUDGET_MS);
+
 	//Time test section 1 for reporting and comparing time.
 	PRINTF("Running timing test...Report this time.\r\n");
+	print_isha_placement();
 	time_pbkdf1(true);
 	PRINTF("Done with timing test...\r\n");
 
@@ -139,6 +281,28 @@ int main(void) {
 	print_pc_profiler_summary();
 	PRINTF("Done with call count test with PC profiling....\r\n");
 
+#ifdef FUNC_TRACE
+	//Time test section 4 for call-level timing with -finstrument-functions.
+	//The per-iteration compressions alone are 8192 events, so exclude them
+	//(-finstrument-functions-exclude-function-list=ISHACompressSingle) to
+	//fit a whole run in the ring.
+	PRINTF("Running call trace of pbkdf1....\r\n");
+	func_trace_reset(false);
+	func_trace_enable(true);
+	time_pbkdf1(false);
+	func_trace_enable(false);
+	print_func_trace_dump();
+	PRINTF("Done with call trace of pbkdf1....\r\n");
+#endif
+
+#ifdef HASH_UPLOAD
+	//Section 5: hash data streamed in over the UART as it arrives.
+	PRINTF("Running hash of UART upload....\r\n");
+	hash_upload();
+	PRINTF("Done with hash of UART upload....\r\n");
+#endif
+
+	bench_console();
 	return 0;
 }
 
@@ -40,6 +40,12 @@
  //Dependencies
 #include "pbkdf1.h"
 #include "isha.h"
+#include "hmac.h"
+#include "probe.h"
+#include "ramfunc.h"
+
+ //PBKDF2 OID (1.2.840.113549.1.5.12)
+ const uint8_t PBKDF2_OID[9] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x05, 0x0C};
 
 
  /**
@@ -62,8 +68,9 @@
  error_t pbkdf1(const uint8_t *p, size_t pLen,
     const uint8_t *s, size_t sLen, uint32_t c, uint8_t *dk, size_t dkLen)
  {
-    uint32_t i;
+    size_t i;
     ISHAContext hashContext;
+    uint8_t t[ISHA_DIGESTLEN];
 
     //Check parameters
     if(p == NULL || s == NULL || dk == NULL)
@@ -78,24 +85,396 @@
        return ERROR_INVALID_LENGTH;
 
     //Apply the hash function to the concatenation of P and S
+    //ISHAReset is written in assembly, so it is probed at the call
+    {
+       PROBE_SCOPE(ISHAReset);
+       ISHAReset(&hashContext);
+    }
+    ISHAInput(&hashContext, p, pLen);
+    ISHAInput(&hashContext, s, sLen);
+    ISHAResult(&hashContext, t);
+
+    //Iterate as many times as required. Every T(i) is exactly one digest
+    //long, so this runs on the fixed single-block kernel
+    isha_rehash_digest(t, c - 1);
+
+    //Only dkLen octets of T(c) are the derived key
+    for(i = 0; i < dkLen; i++)
+       dk[i] = t[i];
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
+
+ /**
+  * @brief PBKDF1 over many (password, salt) pairs at once
+  *
+  * Derives n keys with the same iteration count and key length. The
+  * first hash of each derivation is computed on its own, since every
+  * P || S has its own length; the remaining c - 1 iterations run
+  * ISHA_MAX_LANES derivations at a time on the multi-lane kernel.
+  *
+  * @param[in] in Array of n (password, salt) pairs
+  * @param[in] n Number of derivations
+  * @param[in] c Iteration count
+  * @param[out] dk Derived keys, dkLen octets each, in input order
+  * @param[in] dkLen Intended length in octets of each derived key
+  * @return Error code
+  **/
+
+ error_t pbkdf1_batch(const Pbkdf1Input *in, size_t n, uint32_t c,
+    uint8_t *dk, size_t dkLen)
+ {
+    size_t i, j, k, lanes;
+    ISHAContext hashContext;
+    uint8_t t[ISHA_MAX_LANES][ISHA_DIGESTLEN];
+    uint8_t *tp[ISHA_MAX_LANES];
+
+    //Check parameters
+    if(in == NULL || dk == NULL)
+       return ERROR_INVALID_PARAMETER;
+
+    //The iteration count must be a positive integer
+    if(c < 1)
+       return ERROR_INVALID_PARAMETER;
+
+    //Check the intended length of the derived key
+    if(dkLen > ISHA_DIGESTLEN)
+       return ERROR_INVALID_LENGTH;
+
+    for(i = 0; i < n; i++)
+    {
+       if(in[i].p == NULL || in[i].s == NULL)
+          return ERROR_INVALID_PARAMETER;
+    }
+
+    for(i = 0; i < n; i += lanes)
+    {
+       lanes = (n - i < ISHA_MAX_LANES) ? n - i : ISHA_MAX_LANES;
+
+       //T(1) of each derivation in this group
+       for(j = 0; j < lanes; j++)
+       {
+          ISHAReset(&hashContext);
+          ISHAInput(&hashContext, in[i + j].p, in[i + j].pLen);
+          ISHAInput(&hashContext, in[i + j].s, in[i + j].sLen);
+          ISHAResult(&hashContext, t[j]);
+          tp[j] = t[j];
+       }
+
+       //T(2) ... T(c), all lanes together
+       isha_multi_rehash_digest(tp, lanes, c - 1);
+
+       for(j = 0; j < lanes; j++)
+       {
+          for(k = 0; k < dkLen; k++)
+             dk[(i + j) * dkLen + k] = t[j][k];
+       }
+    }
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
+
+ /**
+  * @brief Start a time-sliced PBKDF1 derivation
+  *
+  * Computes T(1) = Hash(P || S) and leaves the remaining c - 1
+  * iterations to pbkdf1_step(), so that a long derivation can be spread
+  * over many short calls from the main loop.
+  *
+  * @param[out] state Derivation state
+  * @param[in] p Password, an octet string
+  * @param[in] pLen Length in octets of password
+  * @param[in] s Salt, an octet string
+  * @param[in] sLen Length in octets of salt
+  * @param[in] c Iteration count
+  * @return Error code
+  **/
+
+ error_t pbkdf1_begin(Pbkdf1State *state, const uint8_t *p, size_t pLen,
+    const uint8_t *s, size_t sLen, uint32_t c)
+ {
+    ISHAContext hashContext;
+
+    //Check parameters
+    if(state == NULL || p == NULL || s == NULL)
+       return ERROR_INVALID_PARAMETER;
+
+    //The iteration count must be a positive integer
+    if(c < 1)
+       return ERROR_INVALID_PARAMETER;
+
     ISHAReset(&hashContext);
-#ifdef DEBUG
-    INCREMENT_STATIC_COUNT(ISHAResetCount, static_profiling_on); // Insert Static Counter for ISHAReset here as I was unable to set to DEBUG in .s file
-#endif
     ISHAInput(&hashContext, p, pLen);
     ISHAInput(&hashContext, s, sLen);
-    ISHAResult(&hashContext, dk);    // Used pointer dk directly to store the result avoid the use of strcpy from string.h library
+    ISHAResult(&hashContext, state->t);
+
+    state->i = 1;
+    state->c = c;
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
+
+ /**
+  * @brief Continue a derivation from a previously computed T(i)
+  *
+  * Lets a key derived with i iterations be extended to c iterations
+  * without starting over. This needs the full ISHA_DIGESTLEN octets of
+  * T(i); a truncated derived key cannot be extended. A state already in
+  * hand, finished or not, is extended with pbkdf1_extend() instead.
+  *
+  * @param[out] state Derivation state
+  * @param[in] t T(i), ISHA_DIGESTLEN octets
+  * @param[in] i Iterations already applied to t
+  * @param[in] c Target iteration count, at least i
+  * @return Error code
+  **/
+
+ error_t pbkdf1_resume(Pbkdf1State *state, const uint8_t *t, uint32_t i,
+    uint32_t c)
+ {
+    size_t k;
+
+    //Check parameters
+    if(state == NULL || t == NULL || i < 1 || c < i)
+       return ERROR_INVALID_PARAMETER;
+
+    for(k = 0; k < ISHA_DIGESTLEN; k++)
+       state->t[k] = t[k];
+
+    state->i = i;
+    state->c = c;
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
 
-    //Iterate as many times as required
-    for(i = 1; i < c; i++)
+ /**
+  * @brief Raise the target iteration count of a derivation
+  *
+  * Works on a finished state too: pbkdf1_step() then carries it on from
+  * T(i) to T(c), and pbkdf1_finish() outputs the longer key.
+  *
+  * @param[in,out] state Derivation state from pbkdf1_begin() or pbkdf1_resume()
+  * @param[in] c New target iteration count, at least the current one
+  * @return Error code
+  **/
+
+ error_t pbkdf1_extend(Pbkdf1State *state, uint32_t c)
+ {
+    //Check parameters
+    if(state == NULL || state->i < 1 || c < state->c)
+       return ERROR_INVALID_PARAMETER;
+
+    state->c = c;
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
+
+ /**
+  * @brief Apply up to maxIterations more iterations of a derivation
+  *
+  * @param[in,out] state Derivation state
+  * @param[in] maxIterations Most iterations to run in this call
+  * @return NO_ERROR once all c iterations are done, ERROR_IN_PROGRESS
+  *   while some remain
+  **/
+
+ error_t pbkdf1_step(Pbkdf1State *state, uint32_t maxIterations)
+ {
+    uint32_t n;
+
+    //Check parameters
+    if(state == NULL || state->i < 1 || state->i > state->c)
+       return ERROR_INVALID_PARAMETER;
+
+    n = state->c - state->i;
+    if(n > maxIterations)
+       n = maxIterations;
+
+    isha_rehash_digest(state->t, n);
+    state->i += n;
+
+    return (state->i == state->c) ? NO_ERROR : ERROR_IN_PROGRESS;
+ }
+
+
+ /**
+  * @brief Output the key of a completed derivation
+  *
+  * The state is left intact, so it may still be extended to a higher
+  * iteration count afterwards.
+  *
+  * @param[in] state Derivation state
+  * @param[out] dk Derived key
+  * @param[in] dkLen Intended length in octets of the derived key
+  * @return Error code
+  **/
+
+ error_t pbkdf1_finish(Pbkdf1State *state, uint8_t *dk, size_t dkLen)
+ {
+    size_t k;
+
+    //Check parameters
+    if(state == NULL || dk == NULL)
+       return ERROR_INVALID_PARAMETER;
+
+    //Check the intended length of the derived key
+    if(dkLen > ISHA_DIGESTLEN)
+       return ERROR_INVALID_LENGTH;
+
+    //All iterations must have been applied
+    if(state->i != state->c)
+       return ERROR_WRONG_STATE;
+
+    for(k = 0; k < dkLen; k++)
+       dk[k] = state->t[k];
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
+
+ /**
+  * @brief PBKDF2 key derivation function
+  *
+  * PBKDF2 applies a pseudorandom function, HMAC over the given hash, to
+  * derive keys. The length of the derived key is essentially unbounded.
+  *
+  * The HMAC pads are hashed once, by hmacInit(), and every iteration of
+  * every output block starts from the saved midstates, so an iteration
+  * costs two hashes of one digest rather than four.
+  *
+  * @param[in] hash Hash algorithm under HMAC
+  * @param[in] p Password, an octet string
+  * @param[in] pLen Length in octets of password
+  * @param[in] s Salt, an octet string
+  * @param[in] sLen Length in octets of salt
+  * @param[in] c Iteration count
+  * @param[out] dk Derived key
+  * @param[in] dkLen Intended length in octets of the derived key
+  * @return Error code
+  **/
+
+ error_t pbkdf2(const HashAlgo *hash, const uint8_t *p, size_t pLen,
+    const uint8_t *s, size_t sLen, uint32_t c, uint8_t *dk, size_t dkLen)
+ {
+    error_t error;
+    size_t k, n;
+    uint32_t i;
+    HmacContext prf;
+    uint8_t t[HMAC_MAX_DIGEST_SIZE];
+
+    //Check parameters
+    if(hash == NULL || p == NULL || s == NULL || dk == NULL)
+       return ERROR_INVALID_PARAMETER;
+
+    //The iteration count must be a positive integer
+    if(c < 1)
+       return ERROR_INVALID_PARAMETER;
+
+    //The derived key may be at most (2^32 - 1) blocks long
+    if((uint64_t) dkLen > (uint64_t) 0xFFFFFFFF * hash->digestSize)
+       return ERROR_INVALID_LENGTH;
+
+    //The password is the HMAC key
+    error = hmacInit(&prf, hash, p, pLen);
+    if(error)
+       return error;
+
+    //For each block of the derived key, apply the function F
+    for(i = 1; dkLen > 0; i++)
     {
-       //Apply the hash function to T(i - 1)
-       ISHAReset(&hashContext);
-#ifdef DEBUG
-    INCREMENT_STATIC_COUNT(ISHAResetCount, static_profiling_on);
-#endif
-       ISHAInput(&hashContext, dk, ISHA_DIGESTLEN);
-       ISHAResult(&hashContext, dk);
+       n = (dkLen < hash->digestSize) ? dkLen : hash->digestSize;
+
+       //Whole blocks go straight to dk; the last one may be truncated
+       if(n == hash->digestSize)
+       {
+          pbkdf2_block(&prf, s, sLen, c, i, dk);
+       }
+       else
+       {
+          pbkdf2_block(&prf, s, sLen, c, i, t);
+          for(k = 0; k < n; k++)
+             dk[k] = t[k];
+       }
+
+       dk += n;
+       dkLen -= n;
+    }
+
+    //Successful processing
+    return NO_ERROR;
+ }
+
+
+ /**
+  * @brief Compute one block of a PBKDF2 derived key
+  *
+  * T(i) = U(1) XOR U(2) XOR ... XOR U(c), where U(1) = PRF(P, S || INT(i))
+  * and U(j) = PRF(P, U(j - 1)). Blocks are independent and prf is only
+  * read, so different blocks of one key can be computed on different
+  * threads from a shared prf.
+  *
+  * @param[in] prf HMAC context keyed with the password by hmacInit()
+  * @param[in] s Salt, an octet string
+  * @param[in] sLen Length in octets of salt
+  * @param[in] c Iteration count, at least 1
+  * @param[in] i Block index, starting at 1
+  * @param[out] t T(i), digestSize octets
+  * @return Error code
+  **/
+
+ ISHA_HOT error_t pbkdf2_block(const HmacContext *prf, const uint8_t *s, size_t sLen,
+    uint32_t c, uint32_t i, uint8_t *t)
+ {
+    size_t k;
+    uint32_t j;
+    const HashAlgo *hash;
+    HashContext hashContext;
+    uint8_t a[4];
+    uint8_t u[HMAC_MAX_DIGEST_SIZE];
+
+    //Check parameters
+    if(prf == NULL || s == NULL || t == NULL || c < 1 || i < 1)
+       return ERROR_INVALID_PARAMETER;
+
+    hash = prf->hash;
+
+    //INT(i) is a four-octet encoding of the integer i, most significant octet first
+    a[0] = (i >> 24) & 0xFF;
+    a[1] = (i >> 16) & 0xFF;
+    a[2] = (i >> 8) & 0xFF;
+    a[3] = i & 0xFF;
+
+    //U(1) = PRF(P, S || INT(i)), from the saved pad midstates
+    hash->restoreState(&hashContext, &prf->innerState);
+    hash->update(&hashContext, s, sLen);
+    hash->update(&hashContext, a, sizeof(a));
+    hash->final(&hashContext, u);
+
+    hash->restoreState(&hashContext, &prf->outerState);
+    hash->update(&hashContext, u, hash->digestSize);
+    hash->final(&hashContext, u);
+
+    for(k = 0; k < hash->digestSize; k++)
+       t[k] = u[k];
+
+    //U(j) = PRF(P, U(j - 1)), T(i) ^= U(j)
+    for(j = 1; j < c; j++)
+    {
+       hmacDigest(prf, u, u);
+
+       for(k = 0; k < hash->digestSize; k++)
+          t[k] ^= u[k];
     }
 
     //Successful processing
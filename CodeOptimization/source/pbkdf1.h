@@ -36,12 +36,31 @@
 #include <stdint.h>
 
 #include "error.h"
+#include "isha.h"
+#include "hmac.h"
 
  //C++ guard
  #ifdef __cplusplus
  extern "C" {
  #endif
 
+ //Password and salt of one pbkdf1_batch() derivation
+ typedef struct
+ {
+    const uint8_t *p;
+    size_t pLen;
+    const uint8_t *s;
+    size_t sLen;
+ } Pbkdf1Input;
+
+ //State of a time-sliced PBKDF1 derivation
+ typedef struct
+ {
+    uint8_t t[ISHA_DIGESTLEN];  //T(i)
+    uint32_t i;                 //Iterations applied so far
+    uint32_t c;                 //Target iteration count
+ } Pbkdf1State;
+
  //PBKDF related constants
  extern const uint8_t PBKDF2_OID[9];
 
@@ -49,6 +68,23 @@
  error_t pbkdf1(const uint8_t *p, size_t pLen,
     const uint8_t *s, size_t sLen, uint32_t c, uint8_t *dk, size_t dkLen);
 
+ error_t pbkdf1_batch(const Pbkdf1Input *in, size_t n, uint32_t c,
+    uint8_t *dk, size_t dkLen);
+
+ error_t pbkdf1_begin(Pbkdf1State *state, const uint8_t *p, size_t pLen,
+    const uint8_t *s, size_t sLen, uint32_t c);
+ error_t pbkdf1_resume(Pbkdf1State *state, const uint8_t *t, uint32_t i,
+    uint32_t c);
+ error_t pbkdf1_extend(Pbkdf1State *state, uint32_t c);
+ error_t pbkdf1_step(Pbkdf1State *state, uint32_t maxIterations);
+ error_t pbkdf1_finish(Pbkdf1State *state, uint8_t *dk, size_t dkLen);
+
+ error_t pbkdf2(const HashAlgo *hash, const uint8_t *p, size_t pLen,
+    const uint8_t *s, size_t sLen, uint32_t c, uint8_t *dk, size_t dkLen);
+
+ error_t pbkdf2_block(const HmacContext *prf, const uint8_t *s, size_t sLen,
+    uint32_t c, uint32_t i, uint8_t *t);
+
 
  //C++ guard
  #ifdef __cplusplus
@@ -0,0 +1,58 @@
+/*
+ * pbkdf1_calibrate.c
+ *
+ * Iteration-count calibration against a latency budget. See
+ * pbkdf1_calibrate.h.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#include <stdint.h>
+#include "pbkdf1_calibrate.h"
+#include "isha.h"
+#include "ticktime.h"
+
+#define CALIBRATION_US    20000   // how long to measure for
+#define CHUNK_BLOCKS      32      // blocks hashed between clock reads
+
+static uint32_t g_blocks_per_sec;
+
+uint32_t pbkdf1_calibrate(void) {
+	uint8_t t[ISHA_DIGESTLEN] = { 0 };
+	uint32_t blocks = 0;
+	uint32_t start, elapsed;
+
+	// ticktime_us() resolves within a tick, so there is no need to
+	// start on a tick edge
+	start = ticktime_us();
+	do {
+		isha_rehash_digest(t, CHUNK_BLOCKS);
+		blocks += CHUNK_BLOCKS;
+		elapsed = ticktime_us() - start;
+	} while (elapsed < CALIBRATION_US);
+
+	g_blocks_per_sec = (uint64_t) blocks * 1000000 / elapsed;
+	return g_blocks_per_sec;
+}
+
+uint32_t pbkdf1_blocks_per_sec(void) {
+	return g_blocks_per_sec;
+}
+
+uint32_t pbkdf1_iterations_for_budget(uint32_t budget_ms) {
+	uint64_t c;
+
+	if (g_blocks_per_sec == 0) {
+		pbkdf1_calibrate();
+	}
+
+	// Each iteration is one compression, T(1) included
+	c = (uint64_t) budget_ms * g_blocks_per_sec / 1000;
+	if (c < 1) {
+		c = 1;
+	}
+	if (c > UINT32_MAX) {
+		c = UINT32_MAX;
+	}
+	return c;
+}
@@ -0,0 +1,43 @@
+/*
+ * pbkdf1_calibrate.h
+ *
+ * Picks the PBKDF1 iteration count from a latency budget instead of a
+ * hard-coded constant, by measuring ISHA compression throughput on the
+ * board the firmware is actually running on.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#ifndef _PBKDF1_CALIBRATE_H_
+#define _PBKDF1_CALIBRATE_H_
+
+#include <stdint.h>
+
+/*
+ * Measures ISHA compression throughput with the ticktime clock and
+ * remembers the result. Takes about CALIBRATION_US (see
+ * pbkdf1_calibrate.c); call once at boot, after init_ticktime().
+ *
+ * Returns:
+ *   The measured throughput, in blocks per second
+ */
+uint32_t pbkdf1_calibrate(void);
+
+/*
+ * Returns the throughput measured by the last pbkdf1_calibrate(), in
+ * blocks per second, or 0 if it has not run yet
+ */
+uint32_t pbkdf1_blocks_per_sec(void);
+
+/*
+ * Returns the largest PBKDF1 iteration count whose derivation fits in
+ * budget_ms, for a password and salt that together fit in one block.
+ * Calibrates first if that has not been done yet. Never returns less
+ * than 1.
+ *
+ * Parameters:
+ *   budget_ms   Latency budget for one derivation, in msec
+ */
+uint32_t pbkdf1_iterations_for_budget(uint32_t budget_ms);
+
+#endif /* _PBKDF1_CALIBRATE_H_ */
@@ -15,7 +15,10 @@
 #include <string.h>
 
 #include "isha.h"
+#include "isha_tree.h"
 #include "pbkdf1.h"
+#include "pbkdf1_calibrate.h"
+#include "hmac.h"
 
 
 /* 
@@ -159,7 +162,96 @@ bool test_isha()
     }
   }
 
-  return (num_tests*2 == tests_passed);
+  // Third time through: One-shot isha_digest, which only takes messages
+  // that fit in a single block and must reject the rest
+  for (int i=0; i<num_tests; i++) {
+    bool fits, ok;
+    msglen = strlen(tests[i].msg);
+    hexstr_to_bytes(exp_digest, tests[i].hexdigest, ISHA_DIGESTLEN);
+
+    fits = (msglen <= ISHA_ONESHOT_MAXLEN);
+    ok = isha_digest((const unsigned char *)tests[i].msg, msglen, act_digest);
+
+    if (ok == fits && (!fits || cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN))) {
+      PRINTF("%s test %d: success\r\n", __FUNCTION__, i + 2*num_tests);
+      tests_passed++;
+    } else {
+      PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, i + 2*num_tests);
+    }
+  }
+
+  // Every length isha_digest accepts must agree with the context path,
+  // including a 55-byte message whose padding just fits the block
+  uint8_t msg[ISHA_ONESHOT_MAXLEN];
+  bool oneshot_ok = true;
+  for (int len=0; len<=ISHA_ONESHOT_MAXLEN; len++) {
+    msg[len ? len-1 : 0] = (uint8_t)(len * 37);
+    ISHAReset(&ctx);
+    ISHAInput(&ctx, msg, len);
+    ISHAResult(&ctx, exp_digest);
+    isha_digest(msg, len, act_digest);
+    oneshot_ok &= cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN);
+  }
+  if (oneshot_ok) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, 3*num_tests);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, 3*num_tests);
+  }
+
+  // Whole blocks are read straight from the caller's buffer, so hash the
+  // longest message from every word alignment
+  static uint32_t aligned[64];
+  const char *longmsg = tests[num_tests-1].msg;
+  bool align_ok = true;
+  msglen = strlen(longmsg);
+  assert(msglen + 3 <= sizeof(aligned));
+  hexstr_to_bytes(exp_digest, tests[num_tests-1].hexdigest, ISHA_DIGESTLEN);
+  for (int offset=0; offset<4; offset++) {
+    uint8_t *buf = (uint8_t *)aligned + offset;
+    memcpy(buf, longmsg, msglen);
+    ISHAReset(&ctx);
+    ISHAInput(&ctx, buf, msglen);
+    ISHAResult(&ctx, act_digest);
+    align_ok &= cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN);
+  }
+  if (align_ok) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, 3*num_tests + 1);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, 3*num_tests + 1);
+  }
+
+  // Resuming from a midstate saved after the first block, or from a copy
+  // taken mid-block, must give the same digest as hashing from scratch
+  ISHAState state;
+  ISHAContext copy;
+  bool state_ok;
+  ISHAReset(&ctx);
+  ISHAInput(&ctx, (const unsigned char *)longmsg, ISHA_BLOCKLEN);
+  state_ok = ISHASaveState(&ctx, &state);
+  ISHAInput(&ctx, (const unsigned char *)longmsg + ISHA_BLOCKLEN, 10);
+  state_ok &= !ISHASaveState(&ctx, &state);   // not at a block boundary
+  ISHACopy(&copy, &ctx);
+
+  ISHARestoreState(&ctx, &state);
+  ISHAInput(&ctx, (const unsigned char *)longmsg + ISHA_BLOCKLEN, msglen - ISHA_BLOCKLEN);
+  ISHAResult(&ctx, act_digest);
+  state_ok &= cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN);
+
+  ISHAInput(&copy, (const unsigned char *)longmsg + ISHA_BLOCKLEN + 10,
+      msglen - ISHA_BLOCKLEN - 10);
+  ISHAResult(&copy, act_digest);
+  state_ok &= cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN);
+
+  if (state_ok) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, 3*num_tests + 2);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, 3*num_tests + 2);
+  }
+
+  return (num_tests*3 + 3 == tests_passed);
 }
 
 
@@ -223,6 +315,536 @@ bool test_pbkdf1()
     }
   }
 
-  return (num_tests == tests_passed);
+  // Time-sliced derivation in uneven steps must match the one-shot call,
+  // and a finished state must extend to a higher iteration count
+  for (int i=0; i<num_tests; i++) {
+    Pbkdf1State state;
+    error_t ret;
+    int steps = 0;
+
+    if (!tests[i].status)
+      continue;
+
+    passlen = strlen(tests[i].pass);
+    saltlen = strlen(tests[i].salt);
+    hexstr_to_bytes(exp_result, tests[i].hex_result, tests[i].dk_len);
+
+    ret = pbkdf1_begin(&state, (const uint8_t *)tests[i].pass, passlen,
+        (const uint8_t *)tests[i].salt, saltlen, tests[i].iterations);
+    if (ret == NO_ERROR) {
+      while ((ret = pbkdf1_step(&state, 7)) == ERROR_IN_PROGRESS)
+        steps++;
+    }
+    if (ret == NO_ERROR)
+      ret = pbkdf1_finish(&state, act_result, tests[i].dk_len);
+
+    if (ret == NO_ERROR && steps == (tests[i].iterations - 1) / 7 &&
+        cmp_bin(act_result, exp_result, tests[i].dk_len)) {
+      PRINTF("%s test %d: success\r\n", __FUNCTION__, num_tests + i);
+      tests_passed++;
+    } else {
+      PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, num_tests + i);
+    }
+  }
+
+  Pbkdf1State state;
+  bool extend_ok;
+  pbkdf1((const uint8_t *)"password", 8, (const uint8_t *)"mysalt", 6, 2,
+      act_result, ISHA_DIGESTLEN);
+  extend_ok = (pbkdf1_resume(&state, act_result, 2, 3) == NO_ERROR);
+  extend_ok &= (pbkdf1_finish(&state, act_result, 20) == ERROR_WRONG_STATE);
+  extend_ok &= (pbkdf1_step(&state, 1000) == NO_ERROR);
+  extend_ok &= (pbkdf1_extend(&state, 2) == ERROR_INVALID_PARAMETER);
+  extend_ok &= (pbkdf1_extend(&state, 100) == NO_ERROR);
+  extend_ok &= (pbkdf1_step(&state, 1000) == NO_ERROR);
+  extend_ok &= (pbkdf1_finish(&state, act_result, 20) == NO_ERROR);
+  hexstr_to_bytes(exp_result, "C9C355F2BAC4DA6F97A1288069A28274557D51D3", 20);
+  if (extend_ok && cmp_bin(act_result, exp_result, 20)) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, 2*num_tests);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, 2*num_tests);
+  }
+
+  int sliced_tests = 1;
+  for (int i=0; i<num_tests; i++)
+    sliced_tests += tests[i].status;
+
+  return (num_tests + sliced_tests == tests_passed);
+}
+
+
+
+/*
+ * Tests the multi-lane ISHA functions against the single-message ones.
+ * Returns true if all tests pass, false otherwise. Diagnostic
+ * information is printed via PRINTF.
+ */
+bool test_isha_multi()
+{
+  const char *msgs[] =
+    { "abc",
+      "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      "Now his life is full of wonder/But his heart still knows some fear/Of a simple thing, he cannot comprehend/Why they try to tear the mountains down/To bring in a couple more/More people, more scars upon the land"
+    };
+  const int num_tests = sizeof(msgs) / sizeof(msgs[0]);
+  int tests_passed = 0;
+  static uint8_t lane_msg[ISHA_MAX_LANES][256];
+  const uint8_t *in[ISHA_MAX_LANES];
+  uint8_t exp_digest[ISHA_DIGESTLEN];
+  uint8_t act_digest[ISHA_MAX_LANES][ISHA_DIGESTLEN];
+  uint8_t *out[ISHA_MAX_LANES];
+  static ISHAMultiContext mctx;  // too big for the KL25Z stack
+  ISHAContext ctx;
+
+  // Each lane hashes a different variant of the same-length message;
+  // odd-numbered tests deliver the data in 10-byte chunks
+  for (int i=0; i<num_tests*2; i++) {
+    int msglen = strlen(msgs[i/2]);
+    int lanes = (i & 1) ? 5 : ISHA_MAX_LANES;
+    bool ok = true;
+
+    assert(msglen <= sizeof(lane_msg[0]));
+    for (int l=0; l<lanes; l++) {
+      memcpy(lane_msg[l], msgs[i/2], msglen);
+      lane_msg[l][l % msglen] ^= l;
+      in[l] = lane_msg[l];
+      out[l] = act_digest[l];
+    }
+
+    ISHAMultiReset(&mctx, lanes);
+    if (i & 1) {
+      for (int done=0; done<msglen; done+=10) {
+        const uint8_t *chunk[ISHA_MAX_LANES];
+        for (int l=0; l<lanes; l++)
+          chunk[l] = in[l] + done;
+        ISHAMultiInput(&mctx, chunk, min(10, msglen - done));
+      }
+    } else {
+      ISHAMultiInput(&mctx, in, msglen);
+    }
+    ISHAMultiResult(&mctx, out);
+
+    for (int l=0; l<lanes; l++) {
+      ISHAReset(&ctx);
+      ISHAInput(&ctx, lane_msg[l], msglen);
+      ISHAResult(&ctx, exp_digest);
+      ok &= cmp_bin(act_digest[l], exp_digest, ISHA_DIGESTLEN);
+    }
+
+    if (ok) {
+      PRINTF("%s test %d: success\r\n", __FUNCTION__, i);
+      tests_passed++;
+    } else {
+      PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, i);
+    }
+  }
+
+  return (num_tests*2 == tests_passed);
+}
+
+
+/*
+ * Tests pbkdf1_batch against pbkdf1. Returns true if all tests pass,
+ * false otherwise. Diagnostic information is printed via PRINTF.
+ */
+bool test_pbkdf1_batch()
+{
+  typedef struct {
+    int n;
+    int iterations;
+    size_t dk_len;
+  } test_matrix_t;
+
+  test_matrix_t tests[] =
+    { {1, 1, 20}, {4, 2, 20}, {16, 100, 20}, {19, 100, 9}, {40, 3, 20} };
+  const int num_tests = sizeof(tests) / sizeof(test_matrix_t);
+  int tests_passed = 0;
+  static char salts[40][16];
+  Pbkdf1Input in[40];
+  uint8_t exp_result[ISHA_DIGESTLEN];
+  static uint8_t act_result[40 * ISHA_DIGESTLEN];
+
+  // Salts of different lengths, so every lane starts from its own T(1)
+  for (int j=0; j<40; j++) {
+    sprintf(salts[j], "mysalt%d", j * 97);
+    in[j].p = (const uint8_t *)"password";
+    in[j].pLen = 8;
+    in[j].s = (const uint8_t *)salts[j];
+    in[j].sLen = strlen(salts[j]);
+  }
+
+  for (int i=0; i<num_tests; i++) {
+    bool ok = true;
+
+    error_t ret = pbkdf1_batch(in, tests[i].n, tests[i].iterations,
+        act_result, tests[i].dk_len);
+    ok &= (ret == NO_ERROR);
+
+    for (int j=0; j<tests[i].n && ok; j++) {
+      pbkdf1(in[j].p, in[j].pLen, in[j].s, in[j].sLen, tests[i].iterations,
+          exp_result, tests[i].dk_len);
+      ok &= cmp_bin(act_result + j * tests[i].dk_len, exp_result, tests[i].dk_len);
+    }
+
+    if (ok) {
+      PRINTF("%s test %d: success\r\n", __FUNCTION__, i);
+      tests_passed++;
+    } else {
+      PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, i);
+    }
+  }
+
+  // Key lengths above one digest are rejected like pbkdf1 does
+  if (pbkdf1_batch(in, 2, 1, act_result, ISHA_DIGESTLEN + 1) != NO_ERROR) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, num_tests);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, num_tests);
+  }
+
+  return (num_tests + 1 == tests_passed);
+}
+
+
+/*
+ * Byte i of the generated message used by test_isha_tree
+ */
+static uint8_t tree_msg_byte(uint32_t i)
+{
+  return (uint8_t)((i * 2654435761u) >> 24);
+}
+
+/*
+ * Feeds bytes [from, to) of the generated message to an ISHAContext
+ * and/or an ISHATreeContext, in pieces of an awkward size
+ */
+static void tree_msg_input(ISHAContext *ctx, ISHATreeContext *tctx,
+    uint32_t from, uint32_t to)
+{
+  uint8_t piece[100];
+
+  while (from < to) {
+    int n = min(sizeof(piece), to - from);
+    for (int i=0; i<n; i++)
+      piece[i] = tree_msg_byte(from + i);
+    if (ctx)
+      ISHAInput(ctx, piece, n);
+    if (tctx)
+      ISHATreeInput(tctx, piece, n);
+    from += n;
+  }
+}
+
+/*
+ * Tests the ISHA-Tree mode. Returns true if all tests pass, false
+ * otherwise. Diagnostic information is printed via PRINTF.
+ */
+bool test_isha_tree()
+{
+  const uint32_t L = ISHA_TREE_LEAFLEN;
+  const uint32_t lengths[] = { 0, 3, L, L + 1, 3 * L - 7 };
+  const int num_lengths = sizeof(lengths) / sizeof(lengths[0]);
+  int tests_passed = 0, test = 0;
+  uint8_t exp_digest[ISHA_DIGESTLEN];
+  uint8_t act_digest[ISHA_DIGESTLEN];
+  uint8_t leaf[3][ISHA_DIGESTLEN], node[ISHA_DIGESTLEN];
+  uint8_t msg[2 + 8 + ISHA_DIGESTLEN];
+  static const uint8_t leaf_prefix = 0x00;
+  static ISHATreeContext tctx, lctx;  // too big for the KL25Z stack
+  ISHAContext ctx;
+
+  // Streaming input must agree with hashing the leaves separately
+  for (int i=0; i<num_lengths; i++, test++) {
+    uint32_t len = lengths[i];
+
+    ISHATreeReset(&tctx);
+    tree_msg_input(NULL, &tctx, 0, len);
+    ISHATreeResult(&tctx, act_digest);
+
+    ISHATreeReset(&lctx);
+    for (uint32_t off=0; off<len || off==0; off+=L) {
+      uint32_t end = min(len, off + L);
+      ISHAReset(&ctx);
+      ISHAInput(&ctx, &leaf_prefix, 1);
+      tree_msg_input(&ctx, NULL, off, end);
+      ISHAResult(&ctx, leaf[0]);
+      ISHATreeAddLeaf(&lctx, leaf[0], end - off);
+      if (len == 0)
+        break;
+    }
+    ISHATreeResult(&lctx, exp_digest);
+
+    if (cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN)) {
+      PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+      tests_passed++;
+    } else {
+      PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+    }
+  }
+
+  // Three leaves must combine as node(node(leaf0, leaf1), leaf2), and
+  // the digest must be hashed over the version and message length
+  uint8_t pair[1 + 2 * ISHA_DIGESTLEN];
+  pair[0] = 0x01;
+  for (int i=0; i<3; i++) {
+    isha_tree_leaf((const uint8_t *)"leaf", i + 1, leaf[i]);
+  }
+  memcpy(pair + 1, leaf[0], ISHA_DIGESTLEN);
+  memcpy(pair + 1 + ISHA_DIGESTLEN, leaf[1], ISHA_DIGESTLEN);
+  isha_digest(pair, sizeof(pair), node);
+  memcpy(pair + 1, node, ISHA_DIGESTLEN);
+  memcpy(pair + 1 + ISHA_DIGESTLEN, leaf[2], ISHA_DIGESTLEN);
+  isha_digest(pair, sizeof(pair), node);
+
+  msg[0] = 0x02;
+  msg[1] = ISHA_TREE_VERSION;
+  memset(msg + 2, 0, 8);
+  msg[9] = (uint8_t)(2 * L + 3);
+  msg[8] = (uint8_t)((2 * L + 3) >> 8);
+  msg[7] = (uint8_t)((2 * L + 3) >> 16);
+  memcpy(msg + 10, node, ISHA_DIGESTLEN);
+  isha_digest(msg, sizeof(msg), exp_digest);
+
+  ISHATreeReset(&lctx);
+  ISHATreeAddLeaf(&lctx, leaf[0], L);
+  ISHATreeAddLeaf(&lctx, leaf[1], L);
+  ISHATreeAddLeaf(&lctx, leaf[2], 3);
+  ISHATreeResult(&lctx, act_digest);
+
+  if (cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN)) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+  }
+  test++;
+
+  // Known answer, so that the mode cannot change silently
+  hexstr_to_bytes(exp_digest, "3AB781608D77AE4D3A16B65D472D787BFD713DE1", ISHA_DIGESTLEN);
+  ISHATreeReset(&tctx);
+  ISHATreeInput(&tctx, (const uint8_t *)"abc", 3);
+  ISHATreeResult(&tctx, act_digest);
+
+  if (cmp_bin(act_digest, exp_digest, ISHA_DIGESTLEN)) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+  }
+  test++;
+
+  return (test == tests_passed);
 }
 
+
+/*
+ * Reference HMAC-ISHA straight from RFC 2104, hashing the padded key
+ * every time, for checking hmac.c against.
+ */
+static void ref_hmac_isha(const uint8_t *key, size_t keyLen,
+                          const uint8_t *msg, size_t msgLen, uint8_t *out)
+{
+  ISHAContext ctx;
+  uint8_t k[ISHA_BLOCKLEN] = { 0 };
+  uint8_t pad[ISHA_BLOCKLEN];
+  uint8_t inner[ISHA_DIGESTLEN];
+
+  if (keyLen > ISHA_BLOCKLEN) {
+    ISHAReset(&ctx);
+    ISHAInput(&ctx, key, keyLen);
+    ISHAResult(&ctx, k);
+  } else {
+    memcpy(k, key, keyLen);
+  }
+
+  for (int i=0; i<ISHA_BLOCKLEN; i++)
+    pad[i] = k[i] ^ 0x36;
+  ISHAReset(&ctx);
+  ISHAInput(&ctx, pad, ISHA_BLOCKLEN);
+  ISHAInput(&ctx, msg, msgLen);
+  ISHAResult(&ctx, inner);
+
+  for (int i=0; i<ISHA_BLOCKLEN; i++)
+    pad[i] = k[i] ^ 0x5C;
+  ISHAReset(&ctx);
+  ISHAInput(&ctx, pad, ISHA_BLOCKLEN);
+  ISHAInput(&ctx, inner, ISHA_DIGESTLEN);
+  ISHAResult(&ctx, out);
+}
+
+
+/*
+ * Reference PBKDF2-HMAC-ISHA straight from RFC 8018, on ref_hmac_isha
+ */
+static void ref_pbkdf2_isha(const uint8_t *p, size_t pLen,
+                            const uint8_t *s, size_t sLen, uint32_t c,
+                            uint8_t *dk, size_t dkLen)
+{
+  uint8_t msg[64 + 4];
+  uint8_t u[ISHA_DIGESTLEN], t[ISHA_DIGESTLEN];
+
+  assert(sLen <= 64);
+  for (uint32_t i=1; dkLen > 0; i++) {
+    size_t n = min(dkLen, ISHA_DIGESTLEN);
+
+    memcpy(msg, s, sLen);
+    msg[sLen] = i >> 24;
+    msg[sLen + 1] = i >> 16;
+    msg[sLen + 2] = i >> 8;
+    msg[sLen + 3] = i;
+    ref_hmac_isha(p, pLen, msg, sLen + 4, u);
+    memcpy(t, u, ISHA_DIGESTLEN);
+
+    for (uint32_t j=1; j<c; j++) {
+      ref_hmac_isha(p, pLen, u, ISHA_DIGESTLEN, u);
+      for (int k=0; k<ISHA_DIGESTLEN; k++)
+        t[k] ^= u[k];
+    }
+
+    memcpy(dk, t, n);
+    dk += n;
+    dkLen -= n;
+  }
+}
+
+
+/*
+ * Tests hmac.c and pbkdf2() over ishaHashAlgo against the reference
+ * implementations above. Returns true if all tests pass, false
+ * otherwise. Diagnostic information is printed via PRINTF.
+ */
+bool test_pbkdf2()
+{
+  const char *pass[] =
+    { "Boulder",
+      "",
+      "A password longer than one ISHA block, so HMAC has to hash it first.....",
+    };
+  const char *salt = "Buffaloes";
+  const uint32_t iterations[] = { 1, 2, 100 };
+  const size_t dk_lens[] = { 20, 7, 64 };
+  const int num_tests = sizeof(pass) / sizeof(pass[0]);
+  int test = 0, tests_passed = 0;
+  uint8_t exp_result[64];
+  uint8_t act_result[64];
+  HmacContext hmac;
+
+  // HMAC, with a short, an empty and an over-long key, as one call and
+  // then again under the same key after hmacReset()
+  for (int i=0; i<num_tests; i++) {
+    size_t plen = strlen(pass[i]);
+    bool ok;
+
+    ref_hmac_isha((const uint8_t *)pass[i], plen,
+                  (const uint8_t *)salt, strlen(salt), exp_result);
+    ok = (hmacCompute(&ishaHashAlgo, pass[i], plen, salt, strlen(salt),
+                      act_result) == NO_ERROR) &&
+         cmp_bin(act_result, exp_result, ISHA_DIGESTLEN);
+
+    hmacInit(&hmac, &ishaHashAlgo, pass[i], plen);
+    hmacUpdate(&hmac, "junk", 4);
+    hmacFinal(&hmac, act_result);
+    hmacReset(&hmac);
+    hmacUpdate(&hmac, salt, 3);
+    hmacUpdate(&hmac, salt + 3, strlen(salt) - 3);
+    hmacFinal(&hmac, act_result);
+    ok &= cmp_bin(act_result, exp_result, ISHA_DIGESTLEN);
+
+    // The one-digest shortcut used by the PBKDF2 inner loop
+    ref_hmac_isha((const uint8_t *)pass[i], plen, exp_result,
+                  ISHA_DIGESTLEN, exp_result);
+    hmacDigest(&hmac, act_result, act_result);
+    ok &= cmp_bin(act_result, exp_result, ISHA_DIGESTLEN);
+
+    if (ok) {
+      PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+      tests_passed++;
+    } else {
+      PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+    }
+    test++;
+  }
+
+  // PBKDF2, including keys shorter and longer than one digest
+  for (int i=0; i<num_tests; i++) {
+    size_t plen = strlen(pass[i]);
+    error_t err;
+
+    ref_pbkdf2_isha((const uint8_t *)pass[i], plen, (const uint8_t *)salt,
+                    strlen(salt), iterations[i], exp_result, dk_lens[i]);
+    err = pbkdf2(&ishaHashAlgo, (const uint8_t *)pass[i], plen,
+                 (const uint8_t *)salt, strlen(salt), iterations[i],
+                 act_result, dk_lens[i]);
+
+    if (err == NO_ERROR && cmp_bin(act_result, exp_result, dk_lens[i])) {
+      PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+      tests_passed++;
+    } else {
+      PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+    }
+    test++;
+  }
+
+  // Known answer, so that the construction cannot change silently
+  hexstr_to_bytes(exp_result, "575C02F2B8D4B9406EA4B1B656A0034C9195CE243ED5FCD92DBA6DD61B6EA3E8", 32);
+  if (pbkdf2(&ishaHashAlgo, (const uint8_t *)"Boulder", 7,
+             (const uint8_t *)salt, strlen(salt), 4096, act_result, 32) == NO_ERROR
+      && cmp_bin(act_result, exp_result, 32)) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+  }
+  test++;
+
+  // The iteration count must be positive
+  if (pbkdf2(&ishaHashAlgo, (const uint8_t *)"Boulder", 7,
+             (const uint8_t *)salt, strlen(salt), 0, act_result, 20)
+      == ERROR_INVALID_PARAMETER) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+  }
+  test++;
+
+  return (test == tests_passed);
+}
+
+
+/*
+ * Checks that pbkdf1_calibrate() produced a usable measurement and that
+ * pbkdf1_iterations_for_budget() scales with it. Returns true if all
+ * tests pass, false otherwise. Diagnostic information is printed via
+ * PRINTF.
+ */
+bool test_pbkdf1_calibrate()
+{
+  int test = 0, tests_passed = 0;
+  uint32_t blocks_per_sec = pbkdf1_calibrate();
+
+  // The measurement must be usable and must be what the getter reports
+  if (blocks_per_sec > 0 && pbkdf1_blocks_per_sec() == blocks_per_sec) {
+    PRINTF("%s test %d: success (%u blocks/sec)\r\n", __FUNCTION__, test,
+           blocks_per_sec);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+  }
+  test++;
+
+  // Never zero iterations, never fewer for a bigger budget, and one
+  // second's worth is one iteration per measured block
+  if (pbkdf1_iterations_for_budget(0) == 1 &&
+      pbkdf1_iterations_for_budget(10) <= pbkdf1_iterations_for_budget(100) &&
+      pbkdf1_iterations_for_budget(1000) == blocks_per_sec) {
+    PRINTF("%s test %d: success\r\n", __FUNCTION__, test);
+    tests_passed++;
+  } else {
+    PRINTF("%s test %d: FAILURE\r\n", __FUNCTION__, test);
+  }
+  test++;
+
+  return (test == tests_passed);
+}
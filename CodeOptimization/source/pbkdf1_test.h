@@ -58,4 +58,30 @@ void bytes_to_hexstr(char *out_str, const uint8_t *in_str, size_t binary_len);
 bool test_isha();
 bool test_pbkdf1();
 
+/*
+ * Tests ISHAMultiContext and pbkdf1_batch() against their single-message
+ * counterparts, with the same return and reporting conventions.
+ */
+bool test_isha_multi();
+bool test_pbkdf1_batch();
+
+/*
+ * Tests the ISHA-Tree mode, with the same return and reporting
+ * conventions.
+ */
+bool test_isha_tree();
+
+/*
+ * Tests hmac.c and pbkdf2() over ISHA, with the same return and
+ * reporting conventions.
+ */
+bool test_pbkdf2();
+
+/*
+ * Sanity-checks the iteration-count calibration in pbkdf1_calibrate.c,
+ * with the same return and reporting conventions. Requires
+ * init_ticktime() to have been called.
+ */
+bool test_pbkdf1_calibrate();
+
 #endif  // _PBKDF1_TEST_H_
@@ -6,64 +6,85 @@
  *
  *  Modified by Suhas Srinivasa Reddy
  *      Date 2nd Nov 2023
+ *
+ *  Samples are binned by a binary search of pc_symtab, which covers
+ *  every function in the image, instead of five GetFunctionAddress()
+ *  string lookups per SysTick.
  */
 
-#include "MKL25Z4.h"
 #include "fsl_debug_console.h"
 #include "pc_profiler.h"
-#include "isha.h"
+#include "pc_symtab.h"
 
 #define EIGHT (8)
+#define SEVEN (7)
 #define Zero (0)
 
-uint32_t PC_ISHAProcessMessageBlockCount = Zero, PC_ISHAPadMessageCount = Zero,
-		PC_ISHAResetCount = Zero, PC_ISHAInputCount = Zero, PC_ISHAResultCount = Zero,
-		start, end;
 bool pc_profiling_on;
-uint32_t *add;
+
+static uint32_t pc_hits[PC_SYMTAB_MAX];  // samples per pc_symtab entry
+static uint32_t pc_unknown;              // samples outside every entry
+static uint32_t pc_samples;              // all samples taken
+
+#if PC_TRACE_LEN > 0
+#if (PC_TRACE_LEN & (PC_TRACE_LEN - 1)) != 0
+#error "PC_TRACE_LEN must be a power of two"
+#endif
+PCTrace pc_trace = { PC_TRACE_MAGIC, Zero, PC_TRACE_LEN };
+#endif
 
 /*
- * Checks the program counter (PC) to determine which function is being called
- * and increments the respective function's call count.
+ * Finds the function containing pc. See pc_symtab.h.
+ */
+int pc_symtab_find(uint32_t pc) {
+	int lo = Zero, hi = pc_symtab_len, mid;
+
+	// Find the first entry starting after pc; the one before it is the
+	// only one that can contain pc
+	while (lo < hi) {
+		mid = (lo + hi) >> 1;
+		if (pc_symtab[mid].start <= pc) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo > Zero && pc < pc_symtab[lo - 1].end) {
+		return lo - 1;
+	}
+	return -1;
+}
+
+/*
+ * Bins the program counter (PC) saved by the interrupted code against
+ * pc_symtab.
  *
  * Parameters:
  *   pc  Pointer to the program counter (PC)
  */
 void pc_profile_check(uint32_t *pc) {
-	if (!pc_profiling_on) {
-		return;
-	}
-
-	add = (uint32_t*) *(pc+EIGHT);     // Offset Stack Pointer by eight to get Saved Program counter
-
-	GetFunctionAddress("ISHAProcessMessageBlock", &start, &end);
-	if ((uint32_t) add >= start && (uint32_t) add <= end) {
-		PC_ISHAProcessMessageBlockCount++;
-		return;
-	}
-	GetFunctionAddress("ISHAPadMessage", &start, &end);
-	if ((uint32_t) add >= start && (uint32_t) add <= end) {
-		PC_ISHAPadMessageCount++;
-		return;
-	}
+	int i;
 
-	GetFunctionAddress("ISHAReset", &start, &end);
-	if ((uint32_t) add >= start && (uint32_t) add <= end) {
-		PC_ISHAResetCount++;
+	if (!pc_profiling_on) {
 		return;
 	}
 
-	GetFunctionAddress("ISHAInput", &start, &end);
-	if ((uint32_t) add >= start && (uint32_t) add <= end) {
-		PC_ISHAInputCount++;
-		return;
-	}
+#if PC_TRACE_LEN > 0
+	// Raw sample for offline decoding; the saved LR sits just below the PC
+	pc_trace.sample[pc_trace.count & (PC_TRACE_LEN - 1)][0] = *(pc + EIGHT);
+	pc_trace.sample[pc_trace.count & (PC_TRACE_LEN - 1)][1] = *(pc + SEVEN);
+	pc_trace.count++;
+#endif
 
-	GetFunctionAddress("ISHAResult", &start, &end);
-	if ((uint32_t) add >= start && (uint32_t) add <= end) {
-		PC_ISHAResultCount++;
+	// Offset Stack Pointer by eight to get Saved Program counter
+	i = pc_symtab_find(*(pc + EIGHT) & ~1u);
+	if (i >= Zero) {
+		pc_hits[i]++;
+	} else {
+		pc_unknown++;
 	}
-
+	pc_samples++;
 }
 
 /*
@@ -81,18 +102,46 @@ void pc_profile_off(void) {
 }
 
 /*
- * Print a summary of profiler calls for following functions.
- *
+ * Clears the samples taken so far.
+ */
+void pc_profile_reset(void) {
+	int i;
+
+	for (i = Zero; i < pc_symtab_len; i++) {
+		pc_hits[i] = Zero;
+	}
+	pc_unknown = Zero;
+	pc_samples = Zero;
+#if PC_TRACE_LEN > 0
+	pc_trace.count = Zero;
+#endif
+}
+
+/*
+ * Returns the samples binned to pc_symtab entry i.
+ */
+uint32_t pc_profile_hits(int i) {
+	return (i >= Zero && i < pc_symtab_len) ? pc_hits[i] : pc_unknown;
+}
+
+/*
+ * Print the number of samples that landed in each function, in
+ * address order, skipping functions that were never sampled.
  */
 void print_pc_profiler_summary(void) {
 #ifdef DEBUG
-	PRINTF("PC Profile for function call\n\r"
-			"ISHAProcessMessageBlock calls: %u\n\r"
-			"ISHAPadMessage calls: %u\n\r"
-			"ISHAReset calls: %u\n\r"
-			"ISHAInput calls: %u\n\r"
-			"ISHAResult calls: %u\n\r", PC_ISHAProcessMessageBlockCount,
-			PC_ISHAPadMessageCount, PC_ISHAResetCount, PC_ISHAInputCount,
-			PC_ISHAResultCount);
+	int i;
+
+	PRINTF("PC Profile: %u samples\n\r", pc_samples);
+	if (pc_symtab_len == Zero) {
+		PRINTF("WARNING: pc_symtab is empty, so every sample is unknown; build the Debug\n\r");
+		PRINTF("configuration, whose post-build step links in the table from the map\n\r");
+	}
+	for (i = Zero; i < pc_symtab_len; i++) {
+		if (pc_hits[i] != Zero) {
+			PRINTF("%s samples: %u\n\r", pc_symtab[i].name, pc_hits[i]);
+		}
+	}
+	PRINTF("(unknown) samples: %u\n\r", pc_unknown);
 #endif
 }
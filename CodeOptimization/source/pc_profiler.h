@@ -16,10 +16,38 @@
 extern bool pc_profiling_on;
 
 /*
- * Check if the program count pc belongs to one of the isha functions.
+ * Raw (PC, LR) samples for host/profdecode.py, kept alongside the
+ * per-function counts. Dump from the debugger with
+ *   dump binary value pcsamples.bin pc_trace
+ * PC_TRACE_LEN must be a power of two; 0 leaves the trace out.
+ */
+#ifndef PC_TRACE_LEN
+#ifdef DEBUG
+#define PC_TRACE_LEN 128
+#else
+#define PC_TRACE_LEN 0
+#endif
+#endif
+
+#define PC_TRACE_MAGIC 0x31534350  // "PCS1" in memory
+
+#if PC_TRACE_LEN > 0
+typedef struct {
+	uint32_t magic;                   // PC_TRACE_MAGIC
+	uint32_t count;                   // samples taken; the ring wraps past capacity
+	uint32_t capacity;                // PC_TRACE_LEN
+	uint32_t sample[PC_TRACE_LEN][2]; // saved PC and LR, at count % capacity
+} PCTrace;
+
+extern PCTrace pc_trace;
+#endif
+
+/*
+ * Bin the saved program counter against pc_symtab, which covers every
+ * function in the image.
  *
  * Parameters:
- *   pc   - Program Counter
+ *   pc   - Stack pointer at SysTick entry; the saved PC is 8 words up
  */
 void pc_profile_check(uint32_t *pc);
 
@@ -33,10 +61,21 @@ void pc_profile_on(void);
  */
 void pc_profile_off(void);
 
+/*
+ * Clear the samples taken so far.
+ */
+void pc_profile_reset(void);
 
 /*
- * Print a summary of profiler calls for following functions.
+ * Samples binned to pc_symtab entry i, or to no entry if i is -1.
  *
+ * Parameters:
+ *   i    - Index into pc_symtab, as returned by pc_symtab_find()
+ */
+uint32_t pc_profile_hits(int i);
+
+/*
+ * Print the samples per function.
  */
 void print_pc_profiler_summary(void);
 #endif
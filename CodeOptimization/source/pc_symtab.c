@@ -0,0 +1,26 @@
+/*
+ * pc_symtab.c
+ *
+ * The table generated from the map of the last link, pc_symtab.inc in
+ * the build directory, when there is one. The Debug configuration's
+ * post-build step writes it there with host/gen_pc_symtab.py and links
+ * again when it changed, so this file is never rewritten. Otherwise an
+ * empty table, so that a fresh checkout links and every sample lands
+ * in "(unknown)"; host/profdecode.py can still resolve a dumped
+ * pc_trace offline.
+ */
+
+#if defined(__has_include) && __has_include("pc_symtab.inc")
+#include "pc_symtab.inc"
+#else
+
+#include <stddef.h>
+#include "pc_symtab.h"
+
+const PCSymbol pc_symtab[] = {
+	{ 0, 0, NULL },
+};
+
+const uint16_t pc_symtab_len = 0;
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * pc_symtab.h
+ *
+ * Sorted table of the address range of every function in the image,
+ * generated into pc_symtab.c from the linker map by
+ * host/gen_pc_symtab.py. The PC profiler bins its samples by it.
+ */
+
+#ifndef _PC_SYMTAB_H_
+#define _PC_SYMTAB_H_
+
+#include <stdint.h>
+
+#define PC_SYMTAB_MAX 256   // most entries; gen_pc_symtab.py -m must agree
+
+typedef struct {
+	uint32_t start;     // first address, Thumb bit clear
+	uint32_t end;       // one past the last address
+	const char *name;
+} PCSymbol;
+
+/* Sorted by start, non-overlapping */
+extern const PCSymbol pc_symtab[];
+extern const uint16_t pc_symtab_len;
+
+/*
+ * Returns the index in pc_symtab of the function containing pc, or -1
+ * if pc is in none of them. A binary search, so about log2(entries)
+ * steps whatever the address.
+ *
+ * Parameters:
+ *   pc   A code address
+ */
+int pc_symtab_find(uint32_t pc);
+
+#endif /* _PC_SYMTAB_H_ */
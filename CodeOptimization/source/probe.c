@@ -0,0 +1,161 @@
+/*
+ * probe.c
+ *
+ * Registry behind PROBE_SCOPE. See probe.h.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#include "fsl_debug_console.h"
+#include "probe.h"
+#include "ticktime.h"
+
+#define PROBE_DUMP_MAX 512   // print_probe_dump() buffer, in bytes
+
+#if PROBES_ENABLE
+
+bool probes_on;
+static Probe *g_probes;       // registered probes, in order of first use
+static Probe **g_probes_tail = &g_probes;
+
+/*
+ * Links a probe into the registry on its first pass. Probes are kept
+ * in the order they were first hit.
+ */
+void probe_register(Probe *probe) {
+	if (probe->registered) {
+		return;
+	}
+	probe->next = NULL;
+	*g_probes_tail = probe;
+	g_probes_tail = &probe->next;
+	probe->registered = true;
+}
+
+/*
+ * Adds one pass to the scope's probe; called by probe_exit() only for
+ * scopes opened while probes were on.
+ */
+void probe_record(ProbeScope *scope) {
+	Probe *probe = scope->probe;
+	uint32_t elapsed;
+
+	elapsed = ticktime_cycles() - scope->start;
+	probe->count++;
+	probe->total += elapsed;
+	if (elapsed < probe->min) {
+		probe->min = elapsed;
+	}
+	if (elapsed > probe->max) {
+		probe->max = elapsed;
+	}
+}
+
+void probes_enable(bool on) {
+	probes_on = on;
+}
+
+void probes_reset(void) {
+	Probe *probe;
+
+	for (probe = g_probes; probe != NULL; probe = probe->next) {
+		probe->count = 0;
+		probe->total = 0;
+		probe->min = UINT32_MAX;
+		probe->max = 0;
+	}
+}
+
+void print_probe_summary(void) {
+	Probe *probe;
+
+	PRINTF("Probe summary (%u cycles/sec)\r\n", TICKTIME_CYCLE_HZ);
+	for (probe = g_probes; probe != NULL; probe = probe->next) {
+		if (probe->count == 0) {
+			PRINTF("%s calls: 0\r\n", probe->name);
+			continue;
+		}
+		PRINTF("%s calls: %u total: %u avg: %u min: %u max: %u\r\n",
+				probe->name, probe->count, (uint32_t) probe->total,
+				(uint32_t) (probe->total / probe->count), probe->min, probe->max);
+	}
+}
+
+/*
+ * Stores value little-endian in nbytes bytes at buf
+ */
+static uint8_t *put_le(uint8_t *buf, uint64_t value, int nbytes) {
+	while (nbytes--) {
+		*buf++ = value;
+		value >>= 8;
+	}
+	return buf;
+}
+
+size_t probe_dump(uint8_t *buf, size_t len) {
+	Probe *probe;
+	uint8_t *p = buf;
+	size_t need = 10, name_len;
+	uint16_t n = 0;
+
+	for (probe = g_probes; probe != NULL; probe = probe->next) {
+		for (name_len = 0; probe->name[name_len] && name_len < 255; name_len++)
+			;
+		need += 1 + name_len + 20;
+		n++;
+	}
+	if (need > len) {
+		return 0;
+	}
+
+	p = put_le(p, PROBE_DUMP_MAGIC, 4);
+	p = put_le(p, TICKTIME_CYCLE_HZ, 4);
+	p = put_le(p, n, 2);
+	for (probe = g_probes; probe != NULL; probe = probe->next) {
+		for (name_len = 0; probe->name[name_len] && name_len < 255; name_len++)
+			;
+		*p++ = name_len;
+		for (size_t i = 0; i < name_len; i++) {
+			*p++ = probe->name[i];
+		}
+		p = put_le(p, probe->count, 4);
+		p = put_le(p, probe->min, 4);
+		p = put_le(p, probe->max, 4);
+		p = put_le(p, probe->total, 8);
+	}
+	return p - buf;
+}
+
+void print_probe_dump(void) {
+	static uint8_t buf[PROBE_DUMP_MAX];
+	size_t i, n = probe_dump(buf, sizeof(buf));
+
+	PRINTF("PROBES ");
+	for (i = 0; i < n; i++) {
+		PRINTF("%02x", buf[i]);
+	}
+	PRINTF("\r\n");
+}
+
+#else
+
+void probes_enable(bool on) {
+	(void) on;
+}
+
+void probes_reset(void) {
+}
+
+void print_probe_summary(void) {
+}
+
+size_t probe_dump(uint8_t *buf, size_t len) {
+	(void) buf;
+	(void) len;
+	return 0;
+}
+
+void print_probe_dump(void) {
+}
+
+#endif
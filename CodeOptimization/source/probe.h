@@ -0,0 +1,138 @@
+/*
+ * probe.h
+ *
+ * Scoped instrumentation probes. Put PROBE_SCOPE(name) at the top of a
+ * block and every pass through that block, while probes are on, adds
+ * to the probe's call count, inclusive time and min/max duration, in
+ * ticktime_cycles() units. Probes register themselves on first use, so
+ * there is nothing else to declare.
+ *
+ * Probes are built in when PROBES_ENABLE is 1, which is the default
+ * for DEBUG builds; otherwise PROBE_SCOPE expands to nothing.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#ifndef _PROBE_H_
+#define _PROBE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef PROBES_ENABLE
+#ifdef DEBUG
+#define PROBES_ENABLE 1
+#else
+#define PROBES_ENABLE 0
+#endif
+#endif
+
+#define PROBE_DUMP_MAGIC 0x31425250  // "PRB1" in memory
+
+typedef struct Probe {
+	const char *name;
+	uint32_t count;          // completed passes
+	uint32_t min, max;       // shortest and longest pass, in cycles
+	uint64_t total;          // inclusive time of all passes, in cycles
+	struct Probe *next;      // registry link
+	bool registered;
+} Probe;
+
+typedef struct {
+	Probe *probe;            // NULL if probes were off on entry
+	uint32_t start;
+} ProbeScope;
+
+#if PROBES_ENABLE
+
+#include "ticktime.h"
+
+/* Flag to indicate if probes are recording */
+extern bool probes_on;
+
+void probe_register(Probe *probe);
+void probe_record(ProbeScope *scope);
+
+static inline __attribute__((always_inline))
+ProbeScope probe_enter(Probe *probe) {
+	ProbeScope scope = { NULL, 0 };
+
+	if (probes_on) {
+		if (!probe->registered) {
+			probe_register(probe);
+		}
+		scope.probe = probe;
+		scope.start = ticktime_cycles();
+	}
+	return scope;
+}
+
+/*
+ * Closes a scope opened by probe_enter(); called by the compiler on
+ * every exit from the block holding the PROBE_SCOPE. Both are forced
+ * inline, since Debug builds are -O0, so that with probes off a scope
+ * costs a load and a branch at each end, not a call, even in the
+ * per-block ISHA functions.
+ */
+static inline __attribute__((always_inline))
+void probe_exit(ProbeScope *scope) {
+	if (scope->probe != NULL) {
+		probe_record(scope);
+	}
+}
+
+#define PROBE_CAT2(a, b) a##b
+#define PROBE_CAT(a, b) PROBE_CAT2(a, b)
+
+#define PROBE_SCOPE(name) \
+	static Probe PROBE_CAT(probe_, __LINE__) = { #name, 0, UINT32_MAX, 0, 0, NULL, false }; \
+	ProbeScope PROBE_CAT(probe_scope_, __LINE__) __attribute__((cleanup(probe_exit))) \
+			= probe_enter(&PROBE_CAT(probe_, __LINE__))
+
+#else
+
+#define PROBE_SCOPE(name)
+
+#endif
+
+/*
+ * Turns recording on or off. Probes keep their totals while off.
+ */
+void probes_enable(bool on);
+
+/*
+ * Zeroes every registered probe.
+ */
+void probes_reset(void);
+
+/*
+ * Prints one line per registered probe: name, count, total, average,
+ * min and max, in cycles.
+ */
+void print_probe_summary(void);
+
+/*
+ * Writes the registry as a compact binary table, all fields
+ * little-endian, for host/profdecode.py --probes:
+ *
+ *   u32 PROBE_DUMP_MAGIC, u32 cycles per second, u16 number of probes,
+ *   then per probe: u8 name length, name, u32 count, u32 min, u32 max,
+ *   u64 total
+ *
+ * Parameters:
+ *   buf    Output buffer
+ *   len    Size of buf
+ *
+ * Returns:
+ *   Bytes written, or 0 if the table does not fit in len
+ */
+size_t probe_dump(uint8_t *buf, size_t len);
+
+/*
+ * Prints the binary table as one "PROBES <hex>" line on the debug
+ * console, which profdecode.py --probes also accepts.
+ */
+void print_probe_dump(void);
+
+#endif /* _PROBE_H_ */
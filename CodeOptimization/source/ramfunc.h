@@ -0,0 +1,45 @@
+/*
+ * ramfunc.h
+ *
+ * Placement of code in SRAM. Flash on the KL25Z runs at half the 48 MHz
+ * core clock, so every instruction fetch that misses the flash
+ * controller's small cache costs a wait state; SRAM has none.
+ *
+ * RAMFUNC puts a function in the .ramfunc.$RAM input section. The
+ * MCUXpresso managed linker script gathers .ramfunc* into the .data
+ * output section of the first RAM region, with its load image in flash,
+ * so ResetISR copies it to SRAM at boot through __data_section_table
+ * together with the initialized data. Calls between flash and SRAM are
+ * more than 16 MB apart, beyond the reach of BL, so they go through a
+ * long-branch veneer the linker adds; keep a hot loop and what it calls
+ * on the same side.
+ *
+ * ISHA_IN_RAM (default 0) selects whether the ISHA hot path - block
+ * compression, ISHAInput, the PBKDF1 iteration loop in
+ * isha_rehash_digest() and the PBKDF2 one in pbkdf2_block() with the
+ * hmacDigest() it calls - is placed in SRAM, for comparing against the
+ * flash-resident build.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#ifndef _RAMFUNC_H_
+#define _RAMFUNC_H_
+
+#if defined(__arm__)
+#define RAMFUNC __attribute__((section(".ramfunc.$RAM"), noinline))
+#else
+#define RAMFUNC       // Host builds run everything from RAM anyway
+#endif
+
+#ifndef ISHA_IN_RAM
+#define ISHA_IN_RAM 0
+#endif
+
+#if ISHA_IN_RAM
+#define ISHA_HOT RAMFUNC
+#else
+#define ISHA_HOT
+#endif
+
+#endif /* _RAMFUNC_H_ */
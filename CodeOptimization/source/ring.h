@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ * ****************************************************************************/
+
+/**
+ * @file    ring.h
+ * @brief   Typed single-producer, single-consumer ring buffers, generated
+ *          per element type and capacity.
+ *
+ * RING_DEFINE(name, type, capacity) defines a ring type `name` holding
+ * `capacity` elements of `type`, and static inline functions for it:
+ *
+ *   size_t name_enqueue(name *ring, const type *src, size_t n)
+ *   size_t name_dequeue(name *ring, type *dest, size_t n)
+ *   size_t name_length(name *ring)
+ *   size_t name_capacity(void)
+ *   void   name_reset(name *ring)
+ *   size_t name_peek_contiguous(name *ring, type **data)
+ *   void   name_commit(name *ring, size_t n)
+ *   size_t name_reserve_contiguous(name *ring, type **space)
+ *   void   name_commit_enqueue(name *ring, size_t n)
+ *
+ * with the meaning of the cbfifo functions of the same names, counted in
+ * elements. For example
+ *
+ *   RING_DEFINE(SampleRing, uint16_t, 1024)    // ADC samples
+ *   RING_DEFINE(CommandRing, Command, 6)       // message structs
+ *
+ * Only the producer writes tail and only the consumer writes head, so
+ * one side may be an interrupt handler and neither masks interrupts.
+ *
+ * The capacity is a compile-time constant, so the index arithmetic is
+ * chosen at compile time. For a power of two the indices run freely and
+ * a slot is index & (capacity - 1). Otherwise they run modulo twice the
+ * capacity, which keeps full and empty apart, and a slot is one compare
+ * and subtract away; there is never a division.
+ *
+ * This is a copy of CommandProcessor/source/ring.h, whose host tests
+ * exercise it; keep the two in step.
+ *
+ * @author  Suhas Srinivasa Reddy
+ */
+
+#ifndef _RING_H_
+#define _RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Keeps the compiler from moving element accesses across an index update.
+// One core and in-order memory, so interrupt handlers see stores in
+// program order and no DMB is needed.
+#define RING_BARRIER() __asm volatile ("" ::: "memory")
+
+#define RING_IS_POW2(capacity) (((capacity) & ((capacity) - 1)) == 0)
+
+/*
+ * Index arithmetic shared by every ring. capacity is always a constant
+ * at the call, so each folds to the mask or the modulo form.
+ */
+static inline __attribute__((always_inline))
+uint32_t ring_slot(uint32_t index, uint32_t capacity) {
+	if (RING_IS_POW2(capacity)) {
+		return index & (capacity - 1);
+	}
+	return index >= capacity ? index - capacity : index;
+}
+
+static inline __attribute__((always_inline))
+uint32_t ring_advance(uint32_t index, uint32_t n, uint32_t capacity) {
+	if (RING_IS_POW2(capacity)) {
+		return index + n;
+	}
+	index += n;
+	return index >= 2 * capacity ? index - 2 * capacity : index;
+}
+
+static inline __attribute__((always_inline))
+uint32_t ring_used(uint32_t head, uint32_t tail, uint32_t capacity) {
+	if (RING_IS_POW2(capacity)) {
+		return tail - head;
+	}
+	return tail >= head ? tail - head : tail + 2 * capacity - head;
+}
+
+#define RING_DEFINE(name, type, capacity) \
+	_Static_assert((capacity) > 0 && (capacity) <= 0x40000000, \
+			#name ": capacity out of range"); \
+	\
+	typedef struct name { \
+		type data[capacity]; \
+		volatile uint32_t head;    /* elements dequeued, written by the consumer */ \
+		volatile uint32_t tail;    /* elements enqueued, written by the producer */ \
+	} name; \
+	\
+	static inline size_t name##_capacity(void) { \
+		return (capacity); \
+	} \
+	\
+	static inline size_t name##_length(name *ring) { \
+		uint32_t head = ring->head; \
+		return ring_used(head, ring->tail, (capacity)); \
+	} \
+	\
+	static inline void name##_reset(name *ring) { \
+		ring->head = ring->tail; \
+	} \
+	\
+	static inline size_t name##_enqueue(name *ring, const type *src, size_t n) { \
+		uint32_t tail = ring->tail, slot, space, first; \
+		if (!src || n == 0) { \
+			return 0; \
+		} \
+		space = (capacity) - ring_used(ring->head, tail, (capacity)); \
+		RING_BARRIER(); \
+		if (n > space) { \
+			n = space; \
+		} \
+		slot = ring_slot(tail, (capacity)); \
+		first = (capacity) - slot; \
+		if (first > n) { \
+			first = n; \
+		} \
+		memcpy(&ring->data[slot], src, first * sizeof(type)); \
+		memcpy(ring->data, src + first, (n - first) * sizeof(type)); \
+		RING_BARRIER(); \
+		ring->tail = ring_advance(tail, n, (capacity)); \
+		return n; \
+	} \
+	\
+	static inline size_t name##_dequeue(name *ring, type *dest, size_t n) { \
+		uint32_t head = ring->head, slot, used, first; \
+		if (!dest || n == 0) { \
+			return 0; \
+		} \
+		used = ring_used(head, ring->tail, (capacity)); \
+		RING_BARRIER(); \
+		if (n > used) { \
+			n = used; \
+		} \
+		slot = ring_slot(head, (capacity)); \
+		first = (capacity) - slot; \
+		if (first > n) { \
+			first = n; \
+		} \
+		memcpy(dest, &ring->data[slot], first * sizeof(type)); \
+		memcpy(dest + first, ring->data, (n - first) * sizeof(type)); \
+		RING_BARRIER(); \
+		ring->head = ring_advance(head, n, (capacity)); \
+		return n; \
+	} \
+	\
+	static inline size_t name##_peek_contiguous(name *ring, type **data) { \
+		uint32_t head = ring->head; \
+		uint32_t used = ring_used(head, ring->tail, (capacity)); \
+		uint32_t slot = ring_slot(head, (capacity)); \
+		RING_BARRIER(); \
+		*data = &ring->data[slot]; \
+		return used < (capacity) - slot ? used : (capacity) - slot; \
+	} \
+	\
+	static inline void name##_commit(name *ring, size_t n) { \
+		RING_BARRIER(); \
+		ring->head = ring_advance(ring->head, n, (capacity)); \
+	} \
+	\
+	static inline size_t name##_reserve_contiguous(name *ring, type **space) { \
+		uint32_t tail = ring->tail; \
+		uint32_t free = (capacity) - ring_used(ring->head, tail, (capacity)); \
+		uint32_t slot = ring_slot(tail, (capacity)); \
+		RING_BARRIER(); \
+		*space = &ring->data[slot]; \
+		return free < (capacity) - slot ? free : (capacity) - slot; \
+	} \
+	\
+	static inline void name##_commit_enqueue(name *ring, size_t n) { \
+		RING_BARRIER(); \
+		ring->tail = ring_advance(ring->tail, n, (capacity)); \
+	}
+
+#endif // _RING_H_
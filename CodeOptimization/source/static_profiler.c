@@ -6,22 +6,19 @@
  *
  *  Modified by Suhas Srinivasa Reddy
  *      Date 2nd Nov 2023
+ *
+ *  Now a thin layer over the probe registry in probe.c.
  */
 
-#include "MKL25Z4.h"
 #include "fsl_debug_console.h"
-#define Zero (0)
-
-/* Declarations of the counter and profiling flag */
-uint32_t ISHAProcessMessageBlockCount = Zero, ISHAPadMessageCount = Zero, ISHAResetCount = Zero, ISHAInputCount = Zero, ISHAResultCount = Zero;
-bool static_profiling_on = false;
+#include "static_profiler.h"
 
 /*
  * Turns the static profiler on.
  */
 void static_profile_on(void)
 {
-	static_profiling_on = true;
+	probes_enable(true);
 }
 
 /*
@@ -29,20 +26,18 @@ void static_profile_on(void)
  */
 void static_profile_off(void)
 {
-	static_profiling_on = true;
+	probes_enable(false);
 }
 
 /*
- *  Prints the summary of the profiling.
+ *  Prints the summary of the profiling, then the same figures as a
+ *  binary table for host/profdecode.py --probes.
  */
 void print_static_profiler_summary(void)
 {
 #ifdef DEBUG
-	PRINTF("Static Profile for function call\n\r"
-			"ISHAProcessMessageBlock calls: %u\n\r"
-			"ISHAPadMessage calls: %u\n\r"
-			"ISHAReset calls: %u\n\r"
-			"ISHAInput calls: %u\n\r"
-			"ISHAResult calls: %u\n\r", ISHAProcessMessageBlockCount, ISHAPadMessageCount, ISHAResetCount, ISHAInputCount, ISHAResultCount);
+	PRINTF("Static Profile for function call\n\r");
+	print_probe_summary();
+	print_probe_dump();
 #endif
 }
@@ -3,6 +3,10 @@
  *
  *  Created on: Aug 2, 2023
  *      Author: lpandit
+ *
+ *  The counts now come from the PROBE_SCOPE probes in probe.h, which
+ *  also record timing; these functions switch them on and off and
+ *  print them.
  */
 
 #include "stdint.h"
@@ -11,12 +15,7 @@
 #ifndef STATIC_PROFILER_H_
 #define STATIC_PROFILER_H_
 
-
-/* Count values for number of times each function is called when the profiler is turned on. */
-extern uint32_t ISHAProcessMessageBlockCount, ISHAPadMessageCount, ISHAResetCount, ISHAInputCount, ISHAResultCount;
-
-/* Flag to indicate if the profiler is on */
-extern bool static_profiling_on ;
+#include "probe.h"
 
 /*
  * Turns the static profiling on.
@@ -5,17 +5,36 @@
  *
  * Modified by Suhas Srinivasa Reddy
  * 	Date 2nd Nov 2023
+ *
+ * SysTick interrupts at 2.5 kHz instead of 30 kHz. Every reading
+ * combines the interrupt count with SysTick->VAL, so time still
+ * resolves to a core clock, and now() is a shift and an add instead of
+ * a division by SCALE_FACTOR.
  */
 
 #include "MKL25Z4.h"
 #include "core_cm0plus.h"
 #include "ticktime.h"
+#include "fastdiv.h"
 #include "pc_profiler.h"
 
-#define SCALE_FACTOR  3
 #define Zero (0)
+#define TICK_HZ           2500                                 // SysTick interrupts per second
+#define TICK_CYCLES       (TICKTIME_CYCLE_HZ / TICK_HZ)       // core clocks per interrupt
+#define TENTHS_PER_TICK   4                                    // 0.1 msec units per interrupt
+#define CYCLES_PER_TENTH  (TICK_CYCLES / TENTHS_PER_TICK)
+#define US_PER_TICK       (1000000 / TICK_HZ)
+
+// x / 48 as (x * 10923) >> 19, exact for every x below 2^15 > TICK_CYCLES
+#define CYCLES_TO_US(x)   UDIV_CONST(x, 48, 19)
+FASTDIV_CHECK(1, 48, 19, 15);
+
+#if TICK_CYCLES * TICK_HZ != TICKTIME_CYCLE_HZ || TICKTIME_CYCLE_HZ != 48000000 \
+		|| TICK_CYCLES > (1 << 15)
+#error "Re-derive TICK_CYCLES and CYCLES_TO_US for this core clock"
+#endif
 
-static volatile ticktime_t g_now = Zero;
+static volatile uint64_t g_ticks = Zero;  // SysTick interrupts since init_ticktime()
 static ticktime_t g_timer = Zero;
 
 typedef void (*call_back)(uint32_t*);
@@ -23,37 +42,99 @@ typedef void (*call_back)(uint32_t*);
 call_back pc_capture = pc_profile_check;
 
 void init_ticktime(void) {
-	// set control & status register to use 48 MHz/16 = 3 MHz
-	// clock. Then interrupt 10000 times per second
-	SysTick->LOAD = (48000000 / 16) / (SCALE_FACTOR * 10000);
+	// set control & status register to use the 48 MHz core clock, so
+	// that SysTick->VAL counts cycles. Then interrupt TICK_HZ times per
+	// second
+	SysTick->LOAD = TICK_CYCLES - 1;
 	NVIC_SetPriority(SysTick_IRQn, 3);
 	NVIC_ClearPendingIRQ(SysTick_IRQn);
 	NVIC_EnableIRQ(SysTick_IRQn);
 	SysTick->VAL = Zero;
-	SysTick->CTRL &= ~(SysTick_CTRL_CLKSOURCE_Msk);
-	SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+	SysTick->CTRL |= SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk
+			| SysTick_CTRL_ENABLE_Msk;
 
-	g_now = Zero;
+	g_ticks = Zero;
 	g_timer = Zero;
 }
 
 void SysTick_Handler(void) {
+	// Count first, so that any timestamp taken further down this handler
+	// is already past the wrap
+	g_ticks++;
 #ifdef DEBUG
 	register uint32_t *sp;
 	asm("mov %0, sp" : "=r"(sp));  // Retrieve Stack Pointer
 	pc_capture(sp);                // Call PC capture
 #endif
-	g_now++;
+}
+
+/*
+ * Returns the interrupt count and, in *elapsed, the core clocks since
+ * that interrupt, read together so that they never straddle a wrap.
+ *
+ * Interrupts are masked for the two reads. If SysTick wrapped and its
+ * interrupt has not run yet, because interrupts were already masked or
+ * the caller is a handler of equal or higher priority, the interrupt is
+ * pending: that tick is counted here and VAL read again, now certainly
+ * past the wrap. So this works from any context, as long as interrupts
+ * are not held off for more than a whole tick.
+ *
+ * The counter wraps as it reaches 0, so 0 is the first count of the new
+ * tick and LOAD the second.
+ */
+static inline uint64_t __attribute__((no_instrument_function)) read_ticks(uint32_t *elapsed) {
+	uint32_t primask = __get_PRIMASK();
+	uint64_t ticks;
+	uint32_t val;
+
+	__disable_irq();
+	ticks = g_ticks;
+	val = SysTick->VAL;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		ticks++;
+		val = SysTick->VAL;
+	}
+	__set_PRIMASK(primask);
+
+	*elapsed = val ? TICK_CYCLES - val : Zero;
+	return ticks;
 }
 
 ticktime_t now(void) {
-	return g_now / SCALE_FACTOR;
+	uint32_t elapsed;
+	ticktime_t tenths = (ticktime_t) read_ticks(&elapsed) * TENTHS_PER_TICK;
+
+	// elapsed / CYCLES_PER_TENTH, which is 0 to 3
+	tenths += (elapsed >= CYCLES_PER_TENTH) + (elapsed >= 2 * CYCLES_PER_TENTH)
+			+ (elapsed >= 3 * CYCLES_PER_TENTH);
+	return tenths;
 }
 
 void reset_timer(void) {
-	g_timer = g_now;
+	g_timer = now();
 }
 
 ticktime_t get_timer(void) {
-	return (g_now - g_timer) / SCALE_FACTOR;
+	return now() - g_timer;
+}
+
+uint32_t ticktime_cycles(void) {
+	uint32_t elapsed;
+	uint32_t ticks = read_ticks(&elapsed);
+
+	return ticks * TICK_CYCLES + elapsed;
+}
+
+uint64_t ticktime_us64(void) {
+	uint32_t elapsed;
+	uint64_t ticks = read_ticks(&elapsed);
+
+	return ticks * US_PER_TICK + CYCLES_TO_US(elapsed);
+}
+
+uint32_t ticktime_us(void) {
+	uint32_t elapsed;
+	uint32_t ticks = read_ticks(&elapsed);
+
+	return ticks * US_PER_TICK + CYCLES_TO_US(elapsed);
 }
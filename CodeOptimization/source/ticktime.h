@@ -7,6 +7,14 @@
 #ifndef _TICKTIME_H_
 #define _TICKTIME_H_
 
+#include <stdint.h>
+
+#ifdef __arm__
+#define TICKTIME_CYCLE_HZ 48000000    // ticktime_cycles() counts core clocks
+#else
+#define TICKTIME_CYCLE_HZ 1000000000  // host builds count nanoseconds
+#endif
+
 typedef uint32_t ticktime_t;  // time since boot, in tenths of an msec (10 kHz)
                               // 32 bits holds ~5 days of time
 
@@ -34,4 +42,21 @@ void reset_timer(void);
  */
 ticktime_t get_timer(void);
 
+/*
+ * Returns a free-running timestamp in TICKTIME_CYCLE_HZ units, for
+ * timing short stretches of code. It wraps every 2^32 cycles (about
+ * 89 sec), so only differences are meaningful. Safe from any context,
+ * including with interrupts masked; see ticktime.c. Never instrumented,
+ * as the -finstrument-functions hooks in func_trace.c call it.
+ */
+uint32_t ticktime_cycles(void) __attribute__((no_instrument_function));
+
+/*
+ * Returns microseconds since init_ticktime(). The 32-bit version wraps
+ * about every 71 minutes and is meant for differences; the 64-bit one
+ * does not wrap. Safe from any context.
+ */
+uint32_t ticktime_us(void);
+uint64_t ticktime_us64(void);
+
 #endif /* _TICKTIME_H_ */
@@ -0,0 +1,81 @@
+/**
+ * @file    uart_rx.c
+ * @brief   Interrupt-driven UART0 receive into the rx_buffer ring.
+ *
+ * The receive half of CommandProcessor/source/uart.c, on top of the
+ * debug console's UART0 configuration. Received bytes are not echoed,
+ * so that binary uploads can be streamed straight into isha_sink.
+ *
+ * @author  Suhas Reddy S
+ */
+
+#include <MKL25Z4.h>
+#include "cbfifo.h"
+#include "ticktime.h"
+#include "uart_rx.h"
+
+#define ONE (1)
+#define TWO (2)
+#define UART0_S1_ERRORS (UART0_S1_OR_MASK | UART0_S1_NF_MASK | \
+		UART0_S1_FE_MASK | UART0_S1_PF_MASK)
+
+volatile uint32_t uart_rx_dropped;
+volatile uint32_t uart_rx_errors;
+volatile uint32_t uart_rx_first_us, uart_rx_last_us;
+
+static volatile uint32_t g_rx_bytes;  // bytes received since uart_rx_reset()
+
+void Init_UART0_Rx(void) {
+	// May run again with reception already on; stop the interrupt from
+	// enqueueing while the ring is emptied
+	UART0->C2 &= ~UART0_C2_RIE_MASK;
+	cbfifo_reset(&rx_buffer);
+	uart_rx_reset();
+
+	// Clear error flags
+	UART0->S1 = UART0_S1_ERRORS;
+
+	NVIC_SetPriority(UART0_IRQn, TWO); // 0, 1, 2, or 3
+	NVIC_ClearPendingIRQ(UART0_IRQn);
+	NVIC_EnableIRQ(UART0_IRQn);
+
+	// Enable receive interrupts but not transmit interrupts
+	UART0->C2 |= UART0_C2_RIE(ONE);
+}
+
+void uart_rx_reset(void) {
+	uint32_t masking_state = __get_PRIMASK();
+
+	__disable_irq();
+	uart_rx_dropped = ZERO;
+	uart_rx_errors = ZERO;
+	uart_rx_first_us = ZERO;
+	uart_rx_last_us = ZERO;
+	g_rx_bytes = ZERO;
+	__set_PRIMASK(masking_state);
+}
+
+// UART0 IRQ Handler.
+void UART0_IRQHandler(void) {
+	uint8_t s1 = UART0->S1;
+
+	// Count and clear errors; the byte in D, if any, is still read below
+	if (s1 & UART0_S1_ERRORS) {
+		UART0->S1 = UART0_S1_ERRORS;
+		uart_rx_errors++;
+	}
+
+	// Check if the interrupt is due to received data
+	if (s1 & UART0_S1_RDRF_MASK) {
+		char ch = UART0->D;
+		uint32_t t = ticktime_us();
+
+		if (g_rx_bytes++ == ZERO) {
+			uart_rx_first_us = t;
+		}
+		uart_rx_last_us = t;
+		if (cbfifo_enqueue(&rx_buffer, &ch, ONE) != ONE) {
+			uart_rx_dropped++;
+		}
+	}
+}
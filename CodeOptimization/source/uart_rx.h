@@ -0,0 +1,31 @@
+#ifndef UART_RX_H
+#define UART_RX_H
+
+#include <stdint.h>
+
+/* Bytes lost because rx_buffer was full */
+extern volatile uint32_t uart_rx_dropped;
+
+/* Bytes lost to receiver overrun, framing, noise or parity errors */
+extern volatile uint32_t uart_rx_errors;
+
+/* ticktime_us() at the first and the latest byte since uart_rx_reset() */
+extern volatile uint32_t uart_rx_first_us, uart_rx_last_us;
+
+/**
+ * @brief Start interrupt-driven reception on UART0 into rx_buffer.
+ *
+ * UART0 is the debug console, already set up by BOARD_InitDebugConsole();
+ * this only turns on its receive interrupt. Console output keeps using
+ * the SDK's blocking writes. Calling it again empties rx_buffer, with
+ * the receive interrupt held off meanwhile.
+ */
+void Init_UART0_Rx(void);
+
+/**
+ * @brief Clear the counters and timestamps. rx_buffer is left alone, so
+ *        bytes already received are kept.
+ */
+void uart_rx_reset(void);
+
+#endif // UART_RX_H
@@ -311,7 +311,9 @@ void ResetISR(void) {
 #endif // (__USE_CMSIS)
 
     //
-    // Copy the data sections from flash to SRAM.
+    // Copy the data sections from flash to SRAM. This includes any code
+    // marked RAMFUNC (see ramfunc.h), which the managed linker script
+    // places with the initialized data.
     //
 	unsigned int LoadAddr, ExeAddr, SectionLen;
 	unsigned int *SectionTableAddr;
@@ -10,19 +10,22 @@
 
 /**
  * @file    cbfifo.c
- * @brief
+ * @brief   The cbfifo functions, on top of the cbfifo_ring generated by
+ *          RING_DEFINE in cbfifo.h.
  *
+ * See ring.h for how the ring works; these keep the cbfifo names and
+ * signatures for the existing callers.
  *
  * @author  Suhas Srinivasa Reddy
  * @date    19th sept 2023
  *
  */
 #include "cbfifo.h"
-#include <MKL25Z4.h>
 
 Buffer tx_buffer;
-Buffer rx_buffer; // Static initialization of struct buffer
-uint32_t masking_state;
+// Aligned to its size, which UART0 receive DMA needs to wrap its writes
+// within the array
+Buffer rx_buffer __attribute__((aligned(BUFFER_SIZE)));
 
 /**
  * @brief      { This function enqueue nbytes of data into the circular buffer from the source.}
@@ -33,39 +36,7 @@ uint32_t masking_state;
  * @return     { Returns number of bytes enqueued or 0 if no byte is added.}
  */
 size_t cbfifo_enqueue(Buffer *buffer, void *buf, size_t nbyte) {
-	// protect q->Size++ operation from preemption
-	// save current masking state
-	masking_state = __get_PRIMASK();
-	// disable interrupts
-	__disable_irq();
-	// update variable
-
-	if (!buf || nbyte == 0 || buffer->elements == cbfifo_capacity()) {
-		return ZERO; // Nothing to enqueue or buffer is full
-	}
-
-	// Calculates the number of bytes that can be enqueued
-	size_t bytes_to_enqueue =
-			(nbyte <= (cbfifo_capacity() - buffer->elements)) ?
-					nbyte : (cbfifo_capacity() - buffer->elements);
-
-	char *src = (char*) buf;
-
-	// Writing bytes from the source to buffer array
-	for (size_t i = 0; i < bytes_to_enqueue; i++) {
-		buffer->buffer_array[buffer->tail] = src[i];
-		buffer->tail++;
-
-		if (buffer->tail == cbfifo_capacity()) {
-			buffer->tail = 0; // Tail index warp-around
-		}
-
-		buffer->elements++; // Updating number of elements in the buffer
-	}
-
-	// restore  interrupt masking state
-	__set_PRIMASK(masking_state);
-	return bytes_to_enqueue;
+	return cbfifo_ring_enqueue(buffer, (const char*) buf, nbyte);
 }
 
 /**
@@ -77,37 +48,47 @@ size_t cbfifo_enqueue(Buffer *buffer, void *buf, size_t nbyte) {
  * @return     { Returns number of bytes dequeued 0 if no byte is removed.}
  */
 size_t cbfifo_dequeue(Buffer *buffer, void *buf, size_t nbyte) {
-	// protect q->Size++ operation from preemption
-	// save current masking state
-	masking_state = __get_PRIMASK();
-	// disable interrupts
-	__disable_irq();
-	// update variable
-	if (!buf || nbyte == 0 || buffer->elements == 0) {
-		return ZERO; // Nothing to dequeue
-	}
-
-	// Calculates the number of bytes that can be enqueued
-	size_t bytes_to_dequeue =
-			(nbyte <= buffer->elements) ? nbyte : buffer->elements;
-
-	char *dest = (char*) buf;
+	return cbfifo_ring_dequeue(buffer, (char*) buf, nbyte);
+}
 
-	// Reading bytes from the buffer to destination
-	for (size_t i = 0; i < bytes_to_dequeue; i++) {
-		dest[i] = buffer->buffer_array[buffer->head];
-		buffer->head++;
+/**
+ * @brief      { This function gives the consumer the oldest bytes in place.}
+ *
+ * @param[out] data       Set to the oldest byte in the buffer
+ *
+ * @return     { Returns the number of bytes readable at data without a wrap.}
+ */
+size_t cbfifo_peek_contiguous(Buffer *buffer, char **data) {
+	return cbfifo_ring_peek_contiguous(buffer, data);
+}
 
-		if (buffer->head == cbfifo_capacity()) {
-			buffer->head = 0; // Head index warp-around
-		}
+/**
+ * @brief      { This function releases bytes the consumer has read in place.}
+ *
+ * @param[in]  nbyte      Bytes to release, at most what cbfifo_peek_contiguous() returned
+ */
+void cbfifo_commit(Buffer *buffer, size_t nbyte) {
+	cbfifo_ring_commit(buffer, nbyte);
+}
 
-		buffer->elements--;
-	}
-	// restore  interrupt masking state
-	__set_PRIMASK(masking_state);
+/**
+ * @brief      { This function gives the producer free space in place.}
+ *
+ * @param[out] space      Set to the first free byte in the buffer
+ *
+ * @return     { Returns the number of bytes writable at space without a wrap.}
+ */
+size_t cbfifo_reserve_contiguous(Buffer *buffer, char **space) {
+	return cbfifo_ring_reserve_contiguous(buffer, space);
+}
 
-	return bytes_to_dequeue;
+/**
+ * @brief      { This function publishes bytes the producer has written in place.}
+ *
+ * @param[in]  nbyte      Bytes to publish, at most what cbfifo_reserve_contiguous() returned
+ */
+void cbfifo_commit_enqueue(Buffer *buffer, size_t nbyte) {
+	cbfifo_ring_commit_enqueue(buffer, nbyte);
 }
 
 /**
@@ -116,7 +97,7 @@ size_t cbfifo_dequeue(Buffer *buffer, void *buf, size_t nbyte) {
  * @return     { Returns number of elements in the buffer.}
  */
 size_t cbfifo_length(Buffer *buffer) {
-	return buffer->elements;
+	return cbfifo_ring_length(buffer);
 }
 
 /**
@@ -125,26 +106,25 @@ size_t cbfifo_length(Buffer *buffer) {
  * @return     { Returns the total capacity of the buffer.}
  */
 size_t cbfifo_capacity() {
-	return BUFFER_SIZE;
+	return cbfifo_ring_capacity();
 }
 
 /**
  * @brief      { This function resets the buffer.}
  */
 void cbfifo_reset(Buffer *buffer) {
-	buffer->head = 0;
-	buffer->tail = 0;
-	buffer->elements = 0;
+	cbfifo_ring_reset(buffer);
 }
 
+/**
+ * @brief      { This function removes the last enqueued byte, if it is still there.}
+ */
 void cbfifo_clearlastele(Buffer *buffer) {
-	// protect q->Size++ operation from preemption
-	// save current masking state
-	masking_state = __get_PRIMASK();
-	// disable interrupts
-	__disable_irq();
-	// update variable
-	buffer->tail--;
-	// restore  interrupt masking state
-	__set_PRIMASK(masking_state);
+	uint32_t tail = buffer->tail;
+
+	if (tail != buffer->head) {
+		// Step back one; a non-power-of-two ring wraps at twice its size
+		buffer->tail = (RING_IS_POW2(BUFFER_SIZE) || tail) ?
+				tail - 1 : 2 * BUFFER_SIZE - 1;
+	}
 }
@@ -11,18 +11,23 @@
 #define _CBFIFO_H_
 
 #include <stdint.h>  // for size_t
+#include <stddef.h>
+#include "ring.h"
 
-#define BUFFER_SIZE 127
+#define BUFFER_SIZE 128  // a power of two, so slots are found with a mask
 #define ZERO 0
 
-// struct containing buffer parameters
-typedef struct Buffer
-{
-	char buffer_array[BUFFER_SIZE]; // Static memory allocation for the buffer
-    size_t head;
-    size_t tail;
-    size_t elements; // number of elements
-} Buffer;
+/*
+ * The byte ring of ring.h, under the cbfifo names that the UART driver
+ * and tests use. A single-producer, single-consumer ring: only the
+ * producer writes tail and only the consumer writes head, so one side
+ * may be an interrupt handler and neither needs to mask interrupts.
+ * With more than one producer or consumer, the callers on that side
+ * must exclude each other.
+ */
+RING_DEFINE(cbfifo_ring, char, BUFFER_SIZE)
+
+typedef cbfifo_ring Buffer;
 
 extern Buffer tx_buffer, rx_buffer;
 
@@ -66,6 +71,51 @@ size_t cbfifo_enqueue(Buffer *buffer, void *buf, size_t nbyte);
 size_t cbfifo_dequeue(Buffer *buffer, void *buf, size_t nbyte);
 
 
+/*
+ * Zero-copy access for the consumer: points *data at the oldest byte
+ * and returns how many bytes can be read there before the end of the
+ * storage. Read them in place, then release the ones used with
+ * cbfifo_commit(). Once the first run has been committed, a second
+ * call returns the rest, from the start of the storage.
+ *
+ * Parameters:
+ *   buffer   The FIFO
+ *   data     Set to the oldest byte
+ *
+ * Returns:
+ *   Bytes readable at *data, 0 if the FIFO is empty
+ */
+size_t cbfifo_peek_contiguous(Buffer *buffer, char **data);
+
+/*
+ * Releases nbyte bytes read in place after cbfifo_peek_contiguous(),
+ * making their space free for the producer. nbyte must not exceed what
+ * cbfifo_peek_contiguous() returned.
+ */
+void cbfifo_commit(Buffer *buffer, size_t nbyte);
+
+/*
+ * Zero-copy access for the producer: points *space at the first free
+ * byte and returns how many bytes can be written there before the end
+ * of the storage. Write them in place, then publish them with
+ * cbfifo_commit_enqueue().
+ *
+ * Parameters:
+ *   buffer   The FIFO
+ *   space    Set to the first free byte
+ *
+ * Returns:
+ *   Bytes writable at *space, 0 if the FIFO is full
+ */
+size_t cbfifo_reserve_contiguous(Buffer *buffer, char **space);
+
+/*
+ * Publishes nbyte bytes written in place after cbfifo_reserve_contiguous()
+ * to the consumer. nbyte must not exceed what cbfifo_reserve_contiguous()
+ * returned.
+ */
+void cbfifo_commit_enqueue(Buffer *buffer, size_t nbyte);
+
 /*
  * Returns the number of bytes currently on the FIFO.
  *
@@ -92,7 +142,8 @@ size_t cbfifo_capacity();
 /*
  * Resets the FIFO clearing all elements resulting in a 0 length. Basically,
  * the length of the FIFO goes to 0 after reset but capacity and max_capacity
- * stay intact.
+ * stay intact. This discards from the consumer side, so it is safe while
+ * the producer is running.
  *
  * Parameters:
  *   none
@@ -138,6 +189,10 @@ void   cbfifo_reset(Buffer *buffer);
  */
 //int   cbfifo_frozen();
 
+/*
+ * Removes the most recently enqueued byte, if the consumer has not
+ * taken it yet. Producer side only.
+ */
 void cbfifo_clearlastele(Buffer *buffer);
 
 #endif // _CBFIFO_H_
@@ -0,0 +1,120 @@
+/*
+ * fastdiv.h
+ *
+ * Division and modulo by compile-time constants without a divide. The
+ * Cortex-M0+ has no divide instruction, and GCC targeting it calls
+ * __aeabi_uidiv, a shift-and-subtract loop in libgcc, even when the
+ * divisor is a constant, because the usual reciprocal trick needs the
+ * high half of a 32x32 multiply, which ARMv6-M does not have either.
+ *
+ * x * c / d, for x below 2^n, is computed as (x * M) >> s with
+ * M = ceil(c * 2^s / d). With e = M * d - c * 2^s, the error added
+ * before the floor is x * e / (d * 2^s), which is below 1/d, and so
+ * never reaches the next integer, whenever e * 2^n <= 2^s. If M also
+ * fits in 32 - n bits, the product fits in 32 bits and the division is
+ * one MULS and one shift.
+ *
+ *   UMULDIV_CONST(x, c, d, s)   x * c / d, for x < 2^n
+ *   UDIV_CONST(x, d, s)         x / d,     for x < 2^n
+ *   UMOD_CONST(x, d, s)         x % d,     for x < 2^n
+ *
+ * n is a promise about the range of x, and each use is checked at
+ * compile time with FASTDIV_CHECK(c, d, s, n), which fails the build if
+ * s gives an inexact or overflowing result for that range. Start from
+ * s = n + log2(d), rounded up, and go down while the check passes.
+ *
+ * Full 32-bit dividends need a 33-bit or larger product, for which
+ * fastdiv_mulhi() forms the high word from four 16x16 multiplies:
+ *
+ *   UDIV32_CONST(x, d, s)       x / d, for every 32-bit x, s >= 32
+ *
+ * checked with FASTDIV_CHECK32(d, s). udiv10() and umod10() are the
+ * ready-made case for decimal output.
+ *
+ * This is a copy of CodeOptimization/source/fastdiv.h, whose host
+ * tests check it exhaustively; keep the two in step.
+ *
+ * c, d, s and n must be integer constants, with c * 2^s and d * 2^n
+ * below 2^63. UMOD_CONST evaluates x twice.
+ *
+ * Author Suhas Srinivasa Reddy
+ */
+
+#ifndef _FASTDIV_H_
+#define _FASTDIV_H_
+
+#include <stdint.h>
+
+/* ceil(c * 2^s / d), the multiplier */
+#define FASTDIV_M(c, d, s) \
+	((((uint64_t) (c) << (s)) + (d) - 1) / (d))
+
+/* True if (x * M) >> s equals x * c / d for every x below 2^n */
+#define FASTDIV_EXACT(c, d, s, n) \
+	(((FASTDIV_M(c, d, s) * (d) - ((uint64_t) (c) << (s))) << (n)) \
+			<= ((uint64_t) 1 << (s)))
+
+/* True if x * M fits in 32 bits for every x below 2^n */
+#define FASTDIV_FITS32(c, d, s, n) \
+	(FASTDIV_M(c, d, s) <= (UINT32_MAX >> (n)))
+
+#define FASTDIV_CHECK(c, d, s, n) \
+	_Static_assert(FASTDIV_EXACT(c, d, s, n) && FASTDIV_FITS32(c, d, s, n), \
+			"(x * " #c ") / " #d " >> " #s " is not exact for x < 2^" #n)
+
+#define FASTDIV_CHECK32(d, s) \
+	_Static_assert((s) >= 32 && FASTDIV_M(1, d, s) <= UINT32_MAX \
+			&& FASTDIV_EXACT(1, d, s, 32), \
+			"x / " #d " >> " #s " is not exact for every 32-bit x")
+
+#define UMULDIV_CONST(x, c, d, s) \
+	((uint32_t) (((uint32_t) (x) * (uint32_t) FASTDIV_M(c, d, s)) >> (s)))
+
+#define UDIV_CONST(x, d, s)  UMULDIV_CONST(x, 1, d, s)
+
+#define UMOD_CONST(x, d, s)  fastdiv_mod((x), (d), UDIV_CONST(x, d, s))
+
+#define UDIV32_CONST(x, d, s) \
+	(fastdiv_mulhi((x), (uint32_t) FASTDIV_M(1, d, s)) >> ((s) - 32))
+
+/*
+ * The high 32 bits of a * b. The Cortex-M0+ MULS gives only the low
+ * half, and a 64-bit product would call __aeabi_lmul, so the product is
+ * assembled from 16-bit halves: four MULS and a few adds and shifts.
+ */
+static inline uint32_t fastdiv_mulhi16(uint32_t a, uint32_t b) {
+	uint32_t al = a & 0xFFFF, ah = a >> 16;
+	uint32_t bl = b & 0xFFFF, bh = b >> 16;
+	uint32_t lh = al * bh, hl = ah * bl;
+	uint32_t mid = ((al * bl) >> 16) + (lh & 0xFFFF) + (hl & 0xFFFF);
+
+	return ah * bh + (lh >> 16) + (hl >> 16) + (mid >> 16);
+}
+
+static inline uint32_t fastdiv_mulhi(uint32_t a, uint32_t b) {
+#if defined(__arm__)
+	return fastdiv_mulhi16(a, b);
+#else
+	return (uint32_t) (((uint64_t) a * b) >> 32);  // one instruction on the host
+#endif
+}
+
+/* The remainder from a quotient already in hand */
+static inline uint32_t fastdiv_mod(uint32_t x, uint32_t d, uint32_t q) {
+	return x - q * d;
+}
+
+FASTDIV_CHECK32(10, 35);
+
+/*
+ * x / 10 and x % 10 for every 32-bit x
+ */
+static inline uint32_t udiv10(uint32_t x) {
+	return UDIV32_CONST(x, 10, 35);
+}
+
+static inline uint32_t umod10(uint32_t x) {
+	return fastdiv_mod(x, 10, udiv10(x));
+}
+
+#endif /* _FASTDIV_H_ */
@@ -21,6 +21,7 @@
  */
 
 #include <led.h>
+#include "fastdiv.h"
 
 #define PERIOD (4800)
 #define RED_GRADIANT(x) (((uint8_t)(((uint64_t)(x)) >> 16)) & 0xFF)
@@ -31,6 +32,14 @@
 #define green_intensity 1200
 #define blue_intensity 1200
 
+// intensity * gradiant / MAX_GRADIANT by reciprocal multiply; gradiants are 8 bits
+#define SCALE_SHIFT 16
+#define SCALE_GRADIANT(gradiant, intensity) \
+	UMULDIV_CONST(gradiant, intensity, MAX_GRADIANT, SCALE_SHIFT)
+FASTDIV_CHECK(red_intensity, MAX_GRADIANT, SCALE_SHIFT, 8);
+FASTDIV_CHECK(green_intensity, MAX_GRADIANT, SCALE_SHIFT, 8);
+FASTDIV_CHECK(blue_intensity, MAX_GRADIANT, SCALE_SHIFT, 8);
+
 
 // Flow control params
 uint32_t time_remaining = 0;
@@ -105,7 +114,7 @@ void Init_LEDS(void) {
  */
 void Set_RGB(uint64_t color_gradiant) {
 //	LOG("SETTING THE LEDS\n\r\n\r");
-	TPM2->CONTROLS[0].CnV = red_intensity * RED_GRADIANT(color_gradiant) / MAX_GRADIANT;         // Adjusted intensity of each LED to produce near accurate color
-	TPM2->CONTROLS[1].CnV = green_intensity * GREEN_GRADIANT(color_gradiant) / MAX_GRADIANT;
-	TPM0->CONTROLS[1].CnV = blue_intensity * BLUE_GRADIANT(color_gradiant) / MAX_GRADIANT;
+	TPM2->CONTROLS[0].CnV = SCALE_GRADIANT(RED_GRADIANT(color_gradiant), red_intensity);         // Adjusted intensity of each LED to produce near accurate color
+	TPM2->CONTROLS[1].CnV = SCALE_GRADIANT(GREEN_GRADIANT(color_gradiant), green_intensity);
+	TPM0->CONTROLS[1].CnV = SCALE_GRADIANT(BLUE_GRADIANT(color_gradiant), blue_intensity);
 }
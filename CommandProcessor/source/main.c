@@ -35,10 +35,13 @@ int main(void) {
 			inputIndex = 0;
 		} else if (c == '\b') {
 			// Handle Backspace
-			inputIndex--;
-			inputBuffer[inputIndex] = ' ';
-		} else {
-			// Store the character in the input buffer
+			if (inputIndex > 0) {
+				inputIndex--;
+				inputBuffer[inputIndex] = ' ';
+			}
+		} else if (inputIndex < (int) sizeof(inputBuffer) - 1) {
+			// Store the character in the input buffer; a pasted line
+			// longer than the buffer is cut short
 			inputBuffer[inputIndex] = c;
 			inputIndex++;
 		}
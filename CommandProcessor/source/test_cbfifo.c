@@ -2,8 +2,19 @@
 #include "test_cbfifo.h"
 #include "string.h"
 #include "stdio.h"
+#include "ring.h"
 
-#define BUFFER_SIZE 127
+// Rings of other element types and of a capacity that is not a power of two
+typedef struct {
+	uint8_t id;
+	int16_t arg;
+} TestMessage;
+
+RING_DEFINE(SampleRing, uint16_t, 10)
+RING_DEFINE(MessageRing, TestMessage, 4)
+
+static SampleRing sample_ring;
+static MessageRing message_ring;
 
 int cbfifo_tests_passed = 0;
 int cbfifo_tests_failed = 0;
@@ -151,6 +162,116 @@ void test_tx_cbfifo_reset() {
 	TEST_ASSERT(cbfifo_length(&tx_buffer) == 0);
 }
 
+void test_cbfifo_index_wrap() {
+	char data[] = "wrap", dest[10];
+
+	// Start just short of where the free-running indices overflow
+	rx_buffer.head = rx_buffer.tail = UINT32_MAX - 1;
+
+	TEST_ASSERT(cbfifo_enqueue(&rx_buffer, data, strlen(data)) == strlen(data));
+	TEST_ASSERT(cbfifo_length(&rx_buffer) == strlen(data));
+	TEST_ASSERT(cbfifo_dequeue(&rx_buffer, dest, sizeof(dest)) == strlen(data));
+	TEST_ASSERT(memcmp(dest, data, strlen(data)) == 0);
+	TEST_ASSERT(cbfifo_length(&rx_buffer) == 0);
+
+	// Fill it across the overflow, then empty it
+	char fill[BUFFER_SIZE];
+	memset(fill, 'w', sizeof(fill));
+	TEST_ASSERT(cbfifo_enqueue(&rx_buffer, fill, sizeof(fill)) == BUFFER_SIZE);
+	TEST_ASSERT(cbfifo_enqueue(&rx_buffer, data, 1) == 0);
+	TEST_ASSERT(cbfifo_length(&rx_buffer) == BUFFER_SIZE);
+	cbfifo_reset(&rx_buffer);
+	TEST_ASSERT(cbfifo_length(&rx_buffer) == 0);
+}
+
+void test_cbfifo_in_place() {
+	char data[] = "in place", *p;
+	char fill[BUFFER_SIZE - 3];
+	size_t n;
+
+	rx_buffer.head = rx_buffer.tail = 0;
+	memset(fill, 'f', sizeof(fill));
+
+	// Move the indices near the end of the storage so the data wraps
+	cbfifo_enqueue(&rx_buffer, fill, sizeof(fill));
+	TEST_ASSERT(cbfifo_dequeue(&rx_buffer, fill, sizeof(fill)) == sizeof(fill));
+
+	// Two-segment enqueue, read back in place in two runs
+	TEST_ASSERT(cbfifo_enqueue(&rx_buffer, data, strlen(data)) == strlen(data));
+	n = cbfifo_peek_contiguous(&rx_buffer, &p);
+	TEST_ASSERT(n == 3 && memcmp(p, data, n) == 0);
+	cbfifo_commit(&rx_buffer, n);
+	n = cbfifo_peek_contiguous(&rx_buffer, &p);
+	TEST_ASSERT(n == strlen(data) - 3 && memcmp(p, data + 3, n) == 0);
+	cbfifo_commit(&rx_buffer, n);
+	TEST_ASSERT(cbfifo_peek_contiguous(&rx_buffer, &p) == 0);
+
+	// Write in place, then a two-segment dequeue
+	rx_buffer.head = rx_buffer.tail = 0;
+	cbfifo_enqueue(&rx_buffer, fill, sizeof(fill));
+	cbfifo_dequeue(&rx_buffer, fill, sizeof(fill));
+	n = cbfifo_reserve_contiguous(&rx_buffer, &p);
+	TEST_ASSERT(n == 3);
+	memcpy(p, data, n);
+	cbfifo_commit_enqueue(&rx_buffer, n);
+	n = cbfifo_reserve_contiguous(&rx_buffer, &p);
+	TEST_ASSERT(n == BUFFER_SIZE - 3);
+	memcpy(p, data + 3, strlen(data) - 3);
+	cbfifo_commit_enqueue(&rx_buffer, strlen(data) - 3);
+	char dest[sizeof(data)] = { 0 };
+	TEST_ASSERT(cbfifo_dequeue(&rx_buffer, dest, sizeof(dest)) == strlen(data));
+	TEST_ASSERT(strcmp(dest, data) == 0);
+}
+
+void test_ring_modulo_capacity() {
+	uint16_t in[7], out[7], next_in = 0, next_out = 0, *p;
+	int ok = 1;
+
+	TEST_ASSERT(SampleRing_capacity() == 10);
+
+	// Many passes of uneven sizes, so the indices wrap over and over
+	for (int pass = 0; pass < 50; pass++) {
+		size_t n, m = pass % 7 + 1;
+
+		for (size_t i = 0; i < m; i++) {
+			in[i] = next_in + i;
+		}
+		n = SampleRing_enqueue(&sample_ring, in, m);
+		next_in += n;
+		ok &= SampleRing_length(&sample_ring) <= 10;
+
+		n = SampleRing_dequeue(&sample_ring, out, (pass * 3) % 7 + 1);
+		for (size_t i = 0; i < n; i++) {
+			ok &= out[i] == next_out++;
+		}
+	}
+	TEST_ASSERT(ok);
+	TEST_ASSERT(SampleRing_length(&sample_ring) == (uint16_t) (next_in - next_out));
+
+	// Full is not empty
+	SampleRing_reset(&sample_ring);
+	TEST_ASSERT(SampleRing_enqueue(&sample_ring, in, 7) == 7);
+	TEST_ASSERT(SampleRing_enqueue(&sample_ring, in, 7) == 3);
+	TEST_ASSERT(SampleRing_length(&sample_ring) == 10);
+	TEST_ASSERT(SampleRing_reserve_contiguous(&sample_ring, &p) == 0);
+	TEST_ASSERT(SampleRing_peek_contiguous(&sample_ring, &p) > 0 && *p == in[0]);
+}
+
+void test_ring_struct_elements() {
+	TestMessage in[3] = { { 1, -1 }, { 2, 300 }, { 3, -300 } }, out[3], *p;
+
+	MessageRing_reset(&message_ring);
+	TEST_ASSERT(MessageRing_enqueue(&message_ring, in, 3) == 3);
+	TEST_ASSERT(MessageRing_dequeue(&message_ring, out, 1) == 1);
+	TEST_ASSERT(out[0].id == 1 && out[0].arg == -1);
+	TEST_ASSERT(MessageRing_enqueue(&message_ring, in, 3) == 2);
+	TEST_ASSERT(MessageRing_peek_contiguous(&message_ring, &p) == 3);
+	TEST_ASSERT(p->id == 2 && p[2].id == 1);
+	MessageRing_commit(&message_ring, 3);
+	TEST_ASSERT(MessageRing_dequeue(&message_ring, out, 3) == 1);
+	TEST_ASSERT(out[0].id == 2 && out[0].arg == 300);
+}
+
 void run_cbfifo_tests() {
 	printf("Running tests for CBFIFO...\n\r");
 
@@ -164,6 +285,10 @@ void run_cbfifo_tests() {
 	test_tx_cbfifo_dequeue();
 	test_tx_cbfifo_length();
 	test_tx_cbfifo_reset();
+	test_cbfifo_index_wrap();
+	test_cbfifo_in_place();
+	test_ring_modulo_capacity();
+	test_ring_struct_elements();
 
 	printf("Tests passed: %d\n\r", cbfifo_tests_passed);
 	printf("Tests failed: %d\n\r", cbfifo_tests_failed);
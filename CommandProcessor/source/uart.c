@@ -26,22 +26,112 @@
 #define ONE (1)
 #define TWO (2)
 
-// Redirecting Printf to Write to UART console
+// Transmit by DMA from tx_buffer (1) or one TDRE interrupt per byte (0)
+#ifndef UART_TX_DMA
+#define UART_TX_DMA (1)
+#endif
+#define UART_TX_DMA_CH (0)          // DMA channel; its interrupt is DMA0_IRQHandler
+#define DMAMUX_SRC_UART0_TX (3)     // DMAMUX request source for UART0 transmit
+#define DMA_SIZE_BYTE (1)           // DCR SSIZE/DSIZE encoding for 8 bits
+#define DMA_ERRORS (DMA_DSR_BCR_CE_MASK | DMA_DSR_BCR_BES_MASK | DMA_DSR_BCR_BED_MASK)
+
+// Receive by DMA into rx_buffer (1) or one RDRF interrupt per byte (0)
+#ifndef UART_RX_DMA
+#define UART_RX_DMA (1)
+#endif
+#define UART_RX_DMA_CH (1)          // DMA channel; its interrupt is DMA1_IRQHandler
+#define DMAMUX_SRC_UART0_RX (2)     // DMAMUX request source for UART0 receive
+#define RX_DMA_COUNT (0x80000)      // bytes per DMA run, about 2 minutes of input
+
+#if UART_RX_DMA
+// DCR DMOD wraps the destination address within an aligned block of
+// this size, which makes rx_buffer's array a circular DMA target
+#if BUFFER_SIZE == 16
+#define RX_DMA_DMOD (1)
+#elif BUFFER_SIZE == 32
+#define RX_DMA_DMOD (2)
+#elif BUFFER_SIZE == 64
+#define RX_DMA_DMOD (3)
+#elif BUFFER_SIZE == 128
+#define RX_DMA_DMOD (4)
+#elif BUFFER_SIZE == 256
+#define RX_DMA_DMOD (5)
+#elif BUFFER_SIZE == 512
+#define RX_DMA_DMOD (6)
+#elif BUFFER_SIZE == 1024
+#define RX_DMA_DMOD (7)
+#else
+#error "UART_RX_DMA needs BUFFER_SIZE a power of two from 16 to 1024"
+#endif
+#endif
+
+static volatile uint8_t tx_dma_enabled;   // cleared for good if the channel faults
+static volatile uint32_t tx_dma_count;    // bytes in the segment in flight, 0 if idle
+
+static volatile uint8_t rx_dma_enabled;   // cleared for good if the channel faults
+static volatile uint32_t rx_dma_base;     // bytes received before the current DMA run
+static volatile uint32_t rx_dropped;      // bytes lost to a full rx_buffer
+
+static void uart_tx_kick(void);
+static void uart_rx_sync(void);
+
+// Redirecting Printf to Write to UART console, as many bytes per enqueue
+// as there is room for. tx_buffer's producers, this and UART0_Transmit,
+// both run in the main loop, so the enqueue needs no interrupt masking
 int __sys_write(int handle, char *buffer, int size) {
+	size_t n;
 	int count = size;
-	while (count--) {
-		UART0_Transmit((uint8_t*) buffer++);
+
+	while (count > ZERO) {
+		while (cbfifo_length(&tx_buffer) == BUFFER_SIZE)
+			; // wait for space to open up
+		n = cbfifo_enqueue(&tx_buffer, buffer, count);
+		buffer += n;
+		count -= n;
+		uart_tx_kick();
 	}
 	return size;
 }
 
-// Redirecting getchar to read from UART console
+/*
+ * Returns the number of bytes waiting in rx_buffer. With DMA receive,
+ * first brings tail up to what the DMA has written, and if it has lapped
+ * the reader, skips the oldest bytes. One slot is kept free, so the byte
+ * about to be read is not the one the DMA writes next.
+ */
+static size_t uart_rx_available(void) {
+	uint32_t masking_state;
+	size_t length;
+
+	if (!rx_dma_enabled) {
+		return cbfifo_length(&rx_buffer);
+	}
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	uart_rx_sync();
+	__set_PRIMASK(masking_state);
+
+	length = cbfifo_length(&rx_buffer);
+	if (length > BUFFER_SIZE - ONE) {
+		cbfifo_commit(&rx_buffer, length - (BUFFER_SIZE - ONE));
+		rx_dropped += length - (BUFFER_SIZE - ONE);
+		length = BUFFER_SIZE - ONE;
+	}
+	return length;
+}
+
+// Redirecting getchar to read from UART console. The echo is sent here,
+// from the main loop, where waiting for room in tx_buffer is safe
 int __sys_readc(void) {
 	char ch;
 	// Wait until a character is available
-	while (cbfifo_length(&rx_buffer) == ZERO)
+	while (uart_rx_available() == ZERO)
 		;
 	cbfifo_dequeue(&rx_buffer, &ch, ONE);
+	if (ch == '\b') {
+		printf("\b ");
+	}
+	UART0_Transmit((uint8_t*) &ch);
 	return ch;
 }
 
@@ -95,8 +185,10 @@ void Init_UART0() {
 	UART0_BDH_RXEDGIE(ZERO) | UART0_BDH_SBNS(STOP_BITS) | UART0_BDH_LBKDIE(ZERO);
 
 	// Don't enable loopback mode, use 8 data bit mode, use parity and odd parity type
+	// Count idle time from the stop bit, so a character ending in ones is not idle
 	UART0->C1 = UART0_C1_LOOPS(
-			ZERO) | UART0_C1_M(DATA_BITS) | UART0_C1_PE(PARITY_ENABLE) | UART0_C1_PT(PARITY_TYPE);
+			ZERO) | UART0_C1_M(DATA_BITS) | UART0_C1_PE(PARITY_ENABLE) | UART0_C1_PT(PARITY_TYPE)
+			| UART0_C1_ILT(ONE);
 	// Don't invert transmit data, don't enable interrupts for errors
 	UART0->C3 = UART0_C3_TXINV(ZERO) | UART0_C3_ORIE(ZERO)| UART0_C3_NEIE(ZERO)
 	| UART0_C3_FEIE(ZERO) | UART0_C3_PEIE(ZERO);
@@ -112,16 +204,238 @@ void Init_UART0() {
 	NVIC_ClearPendingIRQ(UART0_IRQn);
 	NVIC_EnableIRQ(UART0_IRQn);
 
+#if UART_RX_DMA
+	Init_UART0_RxDMA();
+#else
 	// Enable receive interrupts but not transmit interrupts yet
 	UART0->C2 |= UART_C2_RIE(ONE);
+#endif
 
 	// Enable UART receiver and transmitter
 	UART0->C2 |= UART0_C2_RE(ONE) | UART0_C2_TE(ONE);
 
+#if UART_TX_DMA
+	Init_UART0_TxDMA();
+#endif
+}
+
+/**
+ * @brief   Set up a DMA channel to feed UART0 transmit from tx_buffer.
+ *
+ * Each transfer moves one contiguous run of tx_buffer, read in place, a
+ * byte per TDRE request, and interrupts once when the run is done. The
+ * interrupt releases the run and starts the next, so the CPU does no work
+ * per byte. TDRE interrupts stay off while DMA is in use.
+ */
+void Init_UART0_TxDMA(void) {
+	// Gate clocks to DMA and DMAMUX
+	SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+	SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+
+	// Disable DMA channel to allow configuration
+	DMAMUX0->CHCFG[UART_TX_DMA_CH] = 0;
+
+	// Interrupt when done, increment source only, byte transfers, one
+	// transfer per peripheral request. D_REQ clears ERQ when BCR reaches
+	// zero, so a TDRE request with no run loaded is ignored rather than
+	// starting a zero-length transfer, which is a configuration error
+	DMA0->DMA[UART_TX_DMA_CH].DCR = DMA_DCR_EINT_MASK | DMA_DCR_SINC_MASK
+			| DMA_DCR_SSIZE(DMA_SIZE_BYTE) | DMA_DCR_DSIZE(DMA_SIZE_BYTE)
+			| DMA_DCR_CS_MASK | DMA_DCR_D_REQ_MASK;
+	DMA0->DMA[UART_TX_DMA_CH].DAR = DMA_DAR_DAR((uint32_t) &UART0->D);
+
+	NVIC_SetPriority(DMA0_IRQn, TWO);
+	NVIC_ClearPendingIRQ(DMA0_IRQn);
+	NVIC_EnableIRQ(DMA0_IRQn);
+
+	// UART0 transmit as the trigger, and let TDRE raise DMA requests
+	DMAMUX0->CHCFG[UART_TX_DMA_CH] = DMAMUX_CHCFG_SOURCE(DMAMUX_SRC_UART0_TX)
+			| DMAMUX_CHCFG_ENBL_MASK;
+	UART0->C5 |= UART0_C5_TDMAE_MASK;
+
+	tx_dma_count = ZERO;
+	tx_dma_enabled = ONE;
+}
+
+/**
+ * @brief   Set up a DMA channel to fill rx_buffer from UART0 receive.
+ *
+ * The channel writes each received byte into rx_buffer's array, wrapping
+ * at its end by destination address modulo, with no interrupt per byte.
+ * The idle-line interrupt at the end of a burst, and the reader itself,
+ * bring rx_buffer's tail up to the bytes written. An overrun interrupt
+ * clears OR, which would otherwise stop reception.
+ */
+void Init_UART0_RxDMA(void) {
+	// Gate clocks to DMA and DMAMUX
+	SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+	SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+
+	// Disable DMA channel to allow configuration
+	DMAMUX0->CHCFG[UART_RX_DMA_CH] = 0;
+
+	// Start empty, writing at slot 0 of the aligned array
+	rx_buffer.head = rx_buffer.tail = ZERO;
+	rx_dma_base = ZERO;
+
+	DMA0->DMA[UART_RX_DMA_CH].SAR = DMA_SAR_SAR((uint32_t) &UART0->D);
+	DMA0->DMA[UART_RX_DMA_CH].DAR = DMA_DAR_DAR((uint32_t) rx_buffer.data);
+	DMA0->DMA[UART_RX_DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	DMA0->DMA[UART_RX_DMA_CH].DSR_BCR = DMA_DSR_BCR_BCR(RX_DMA_COUNT);
+
+	// Interrupt when done, increment destination only, wrap it at the end
+	// of the array, byte transfers, one transfer per peripheral request
+	DMA0->DMA[UART_RX_DMA_CH].DCR = DMA_DCR_EINT_MASK | DMA_DCR_DINC_MASK
+			| DMA_DCR_SSIZE(DMA_SIZE_BYTE) | DMA_DCR_DSIZE(DMA_SIZE_BYTE)
+			| DMA_DCR_DMOD(RX_DMA_DMOD) | DMA_DCR_CS_MASK | DMA_DCR_ERQ_MASK;
+
+	NVIC_SetPriority(DMA1_IRQn, TWO);
+	NVIC_ClearPendingIRQ(DMA1_IRQn);
+	NVIC_EnableIRQ(DMA1_IRQn);
+
+	// UART0 receive as the trigger; RDRF raises DMA requests instead of
+	// interrupts, and idle line and overrun interrupt
+	DMAMUX0->CHCFG[UART_RX_DMA_CH] = DMAMUX_CHCFG_SOURCE(DMAMUX_SRC_UART0_RX)
+			| DMAMUX_CHCFG_ENBL_MASK;
+	UART0->C5 |= UART0_C5_RDMAE_MASK;
+	UART0->C3 |= UART0_C3_ORIE(ONE);
+	UART0->C2 |= UART0_C2_ILIE(ONE);
+
+	rx_dma_enabled = ONE;
+}
+
+/*
+ * Brings rx_buffer's tail up to the bytes the DMA has written. Called
+ * from the UART0 and DMA1 interrupts, which do not preempt each other,
+ * or with interrupts masked, so tail has one writer at a time.
+ */
+static void uart_rx_sync(void) {
+	uint32_t left = DMA0->DMA[UART_RX_DMA_CH].DSR_BCR & DMA_DSR_BCR_BCR_MASK;
+	uint32_t written = rx_dma_base + (RX_DMA_COUNT - left);
+
+	cbfifo_commit_enqueue(&rx_buffer, written - rx_buffer.tail);
+}
+
+/*
+ * Falls back to interrupt-driven receive, after taking in whatever the
+ * DMA wrote.
+ */
+static void uart_rx_dma_disable(void) {
+	DMA0->DMA[UART_RX_DMA_CH].DCR &= ~DMA_DCR_ERQ_MASK;
+	UART0->C5 &= ~UART0_C5_RDMAE_MASK;
+	DMAMUX0->CHCFG[UART_RX_DMA_CH] = 0;
+	uart_rx_sync();
+	rx_dma_enabled = ZERO;
+	UART0->C2 &= ~UART0_C2_ILIE_MASK;
+	UART0->C2 |= UART_C2_RIE(ONE);
+}
+
+/**
+ * @brief   Number of received bytes lost because rx_buffer was full.
+ */
+uint32_t UART0_RxDropped(void) {
+	return rx_dropped;
+}
+
+/*
+ * Starts a DMA transfer of the next contiguous run of tx_buffer, if
+ * there is one. Called with the channel idle, from the DMA interrupt or
+ * with interrupts masked.
+ */
+static void uart_tx_dma_start(void) {
+	char *next;
+	size_t n = cbfifo_peek_contiguous(&tx_buffer, &next);
+
+	tx_dma_count = n;
+	if (n == ZERO) {
+		// Nothing to send; D_REQ has already cleared ERQ, keep it off
+		DMA0->DMA[UART_TX_DMA_CH].DCR &= ~DMA_DCR_ERQ_MASK;
+		return;
+	}
+	// Clear DONE and the error flags, then load source and count
+	DMA0->DMA[UART_TX_DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	DMA0->DMA[UART_TX_DMA_CH].SAR = DMA_SAR_SAR((uint32_t) next);
+	DMA0->DMA[UART_TX_DMA_CH].DSR_BCR = DMA_DSR_BCR_BCR(n);
+	DMA0->DMA[UART_TX_DMA_CH].DCR |= DMA_DCR_ERQ_MASK;
+}
+
+/*
+ * Falls back to interrupt-driven transmit: stops DMA requests and lets
+ * TDRE interrupts carry on from whatever is left in tx_buffer.
+ */
+static void uart_tx_dma_disable(void) {
+	DMA0->DMA[UART_TX_DMA_CH].DCR &= ~DMA_DCR_ERQ_MASK;
+	UART0->C5 &= ~UART0_C5_TDMAE_MASK;
+	DMAMUX0->CHCFG[UART_TX_DMA_CH] = 0;
+	tx_dma_enabled = ZERO;
+	tx_dma_count = ZERO;
+	UART0->C2 |= UART_C2_TIE(ONE);
+}
+
+/*
+ * Gets newly queued bytes moving: starts DMA if the channel is idle, or
+ * enables the TDRE interrupt when DMA is not in use.
+ */
+static void uart_tx_kick(void) {
+	uint32_t masking_state;
+
+	if (!tx_dma_enabled) {
+		// Enable transmitter interrupt
+		UART0->C2 |= UART_C2_TIE(ONE);
+		return;
+	}
+	// The DMA interrupt also starts transfers
+	masking_state = __get_PRIMASK();
+	__disable_irq();
+	if (tx_dma_count == ZERO) {
+		uart_tx_dma_start();
+	}
+	__set_PRIMASK(masking_state);
+}
+
+// DMA channel 0 IRQ Handler: a run of tx_buffer has been sent.
+void DMA0_IRQHandler(void) {
+	uint32_t status = DMA0->DMA[UART_TX_DMA_CH].DSR_BCR;
+	uint32_t left = status & DMA_DSR_BCR_BCR_MASK;
+
+	// Clear done and error flags
+	DMA0->DMA[UART_TX_DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+
+	// Release what went out; on an error, the rest goes by interrupts
+	cbfifo_commit(&tx_buffer, tx_dma_count - left);
+	if (status & DMA_ERRORS) {
+		uart_tx_dma_disable();
+		return;
+	}
+	uart_tx_dma_start();
+}
+
+// DMA channel 1 IRQ Handler: a receive run has used up its count.
+void DMA1_IRQHandler(void) {
+	uint32_t status = DMA0->DMA[UART_RX_DMA_CH].DSR_BCR;
+
+	if (status & DMA_ERRORS) {
+		DMA0->DMA[UART_RX_DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+		uart_rx_dma_disable();
+		return;
+	}
+	// Take in the whole run, then start another where it left off; the
+	// destination address carries on around the array
+	uart_rx_sync();
+	rx_dma_base += RX_DMA_COUNT;
+	DMA0->DMA[UART_RX_DMA_CH].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	DMA0->DMA[UART_RX_DMA_CH].DSR_BCR = DMA_DSR_BCR_BCR(RX_DMA_COUNT);
 }
 
 // UART0 IRQ Handler.
 void UART0_IRQHandler(void) {
+	// End of a receive burst: make what the DMA wrote visible. Checked
+	// before the error flags, as clearing those writes IDLE too
+	if (rx_dma_enabled && (UART0->S1 & UART0_S1_IDLE_MASK)) {
+		UART0->S1 = UART0_S1_IDLE_MASK;
+		uart_rx_sync();
+	}
+
 	// Check for errors
 	if (UART0->S1 & (UART0_S1_OR_MASK | UART0_S1_NF_MASK |
 	UART0_S1_FE_MASK | UART0_S1_PF_MASK)) {
@@ -132,27 +446,30 @@ void UART0_IRQHandler(void) {
 		// You might also reset or handle other aspects of your application
 	}
 
-	// Check if the interrupt is due to received data
-	if (UART0->S1 & UART0_S1_RDRF_MASK) {
+	// Check if the interrupt is due to received data; only when RDRF
+	// interrupts are in use, as otherwise the byte belongs to the DMA
+	if ((UART0->C2 & UART0_C2_RIE_MASK) && (UART0->S1 & UART0_S1_RDRF_MASK)) {
 		char ch;
-		// received a character
+		// received a character; the echo is sent by __sys_readc
 		ch = UART0->D;
-		if (ch == '\b') {
-			printf("\b ");
-		}
-		UART0_Transmit((uint8_t*) &ch);
-		if (cbfifo_length(&rx_buffer) < BUFFER_SIZE) {
-			cbfifo_enqueue(&rx_buffer, &ch, ONE);
+		// Store it in place; a full buffer drops it
+		char *slot;
+		if (cbfifo_reserve_contiguous(&rx_buffer, &slot)) {
+			*slot = ch;
+			cbfifo_commit_enqueue(&rx_buffer, ONE);
+		} else {
+			rx_dropped++;
 		}
 	}
 
-	// Check if the interrupt is due to the transmitter being ready
-	if (UART0->S1 & UART0_S1_TDRE_MASK) {
-		char ch;
-		// can send another character
-		if (cbfifo_length(&tx_buffer) != ZERO) {
-			cbfifo_dequeue(&tx_buffer, &ch, ONE);
-			UART0->D = ch;
+	// Check if the interrupt is due to the transmitter being ready; only
+	// when TDRE interrupts are in use, not while DMA is sending
+	if ((UART0->C2 & UART0_C2_TIE_MASK) && (UART0->S1 & UART0_S1_TDRE_MASK)) {
+		char *next;
+		// can send another character, read in place
+		if (cbfifo_peek_contiguous(&tx_buffer, &next)) {
+			UART0->D = *next;
+			cbfifo_commit(&tx_buffer, ONE);
 		} else {
 			// queue is empty, disable transmitter interrupt
 			UART0->C2 &= ~UART0_C2_TIE_MASK;
@@ -165,18 +482,19 @@ void UART0_IRQHandler(void) {
  *
  * This function enqueues an array of bytes for transmission over UART0.
  * It waits for space to become available in the circular buffer before enqueuing the data.
- * Once the data is enqueued, it enables the UART transmitter interrupt to start the transmission process.
+ * Once the data is enqueued, it starts a DMA transfer, or the UART transmitter interrupt, to send it.
  *
  * @param data The array of bytes to be transmitted.
  *
  * @note    The function uses a circular buffer (`cbfifo`) for managing the transmit data.
  * @note    It waits for space to open up in the circular buffer before enqueuing the data.
- * @note    The UART transmitter interrupt is enabled to initiate the transmission process.
+ * @note    Must not be called from an interrupt handler: tx_buffer's
+ *          producers, printf and the echo in __sys_readc, both run in the
+ *          main loop, which is what lets the enqueue go unmasked.
  */
 void UART0_Transmit(uint8_t *data) {
 	while (cbfifo_length(&tx_buffer) == BUFFER_SIZE)
 		; // wait for space to open up
 	cbfifo_enqueue(&tx_buffer, data, ONE);
-	// Enable transmitter interrupt
-	UART0->C2 |= UART_C2_TIE(ONE);
+	uart_tx_kick();
 }
@@ -12,6 +12,32 @@
  */
 void Init_UART0(void);
 
+/**
+ * @brief Send UART0 output from tx_buffer by DMA, one interrupt per run.
+ *
+ * Called by Init_UART0() when UART_TX_DMA is 1, the default. If the DMA
+ * channel reports an error, transmit falls back to one TDRE interrupt
+ * per byte.
+ */
+void Init_UART0_TxDMA(void);
+
+/**
+ * @brief Receive UART0 input into rx_buffer by DMA.
+ *
+ * Called by Init_UART0() when UART_RX_DMA is 1, the default. The DMA
+ * channel fills rx_buffer without an interrupt per byte; the idle-line
+ * interrupt marks the end of each burst. If the channel reports an
+ * error, receive falls back to one RDRF interrupt per byte.
+ */
+void Init_UART0_RxDMA(void);
+
+/**
+ * @brief Number of received bytes lost because rx_buffer was full.
+ *
+ * @return Bytes dropped since reset.
+ */
+uint32_t UART0_RxDropped(void);
+
 /**
  * @brief Send a null-terminated string over UART0.
  *
@@ -125,6 +125,7 @@ void bubbleSort(uint16_t arr[], uint16_t n) {
  *          The result is stored in the global variable 'avg'.
  */
 void compute_avg(void) {
+	sum = 0;
 	for (int i = 0; i < 1024; i++) {
 		sum+= ADC_buffer[i];
 	}